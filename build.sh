@@ -39,6 +39,7 @@ elif [ "$type" == "help" ]; then
   echo "Usage: ./build.sh [clean]: Clean the build directory"
   echo "Usage: ./build.sh [run] [data] [num_agents_min] [num_agents_max] [num_data]"
   echo "Usage: ./build.sh [run] [run] [num_agents]"
+  echo "Usage: ./build.sh [run] [bench] [num_queries]: Run the benchmarks on the selected map"
   echo "Usage: ./build.sh [doc]: Create the documentation (doxygen and latex)"
   echo "Usage: ./build.sh [sign]: Sign the binary for MacOS"
 else
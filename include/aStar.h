@@ -9,6 +9,14 @@
 
 #include "cityGraph.h"
 #include "config.h"
+#include "indexedHeap.h"
+#include "nodeTable.h"
+#include "searchStats.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+class RouteCache;
 
 /**
  * @struct _aStarNode
@@ -21,6 +29,7 @@ typedef struct _aStarNode {
   _cityGraphPoint point;                                  /**< \brief The point in the graph */
   double speed;                                           /**< \brief The speed of the car */
   std::pair<_cityGraphPoint, _cityGraphNeighbor> arcFrom; /**< \brief The arc from which the node was reached */
+  double waitTime = 0;                                    /**< \brief The time stopped at the start of the arc */
 
   bool operator==(const _aStarNode &other) const {
     double s = std::round(speed / SPEED_RESOLUTION);
@@ -65,16 +74,89 @@ template <> struct hash<_aStarConflict> {
 };
 } // namespace std
 
+/**
+ * @struct _aStarContext
+ * @brief Reusable buffers of an A* search
+ *
+ * This struct holds the node table, the open set heap and the path buffer of an A* search. The buffers are cleared
+ * (not freed) between two queries, so repeated searches do not pay for their allocation again.
+ */
+typedef struct _aStarContext {
+  NodeTable nodes;               /**< \brief The reached states, with their parent, g and f scores */
+  IndexedHeap<> openSet;         /**< \brief The open set of node table indices, keyed by f-score */
+  std::vector<_aStarNode> path;  /**< \brief The last path found */
+  double pathCost = 0;           /**< \brief The travel time of the last path found */
+  double suboptimalityBound = 1; /**< \brief Upper bound of the path cost divided by the optimal cost */
+  _searchStats stats;            /**< \brief The statistics of the last search */
+
+  /**
+   * @brief Clear the buffers, keeping their allocated memory
+   */
+  void clear() {
+    nodes.clear();
+    openSet.clear();
+    path.clear();
+    pathCost = 0;
+    suboptimalityBound = 1;
+    stats = _searchStats();
+  }
+
+  /**
+   * @brief Complete the statistics of the search that ran in the context
+   * @param startTime The start time of the search
+   * @param found If the search found a path
+   */
+  void finishStats(std::chrono::steady_clock::time_point startTime, bool found) {
+    stats.numSearches = 1;
+    stats.numFound = found;
+    stats.numProbes = nodes.getNumProbes();
+    stats.successorTime -= stats.constraintTime;
+    stats.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  }
+
+  /**
+   * @brief Rebuild the path ending at a record by walking the parent indices
+   * @param graph The graph the search ran on
+   * @param index The index of the last record of the path
+   */
+  void reconstructPath(const CityGraph &graph, int index) {
+    path.clear();
+    for (; index >= 0; index = nodes[index].parent) {
+      const NodeTable::record &record = nodes[index];
+      _aStarNode node{};
+      node.point = graph.getPoint(record.key.point);
+      node.speed = record.speed;
+      node.waitTime = record.wait;
+      if (record.edge >= 0) {
+        const CityGraph::edge &edge = graph.getEdge(record.edge);
+        node.arcFrom = {graph.getPoint(edge.from), edge.neighbor};
+      }
+      path.push_back(node);
+    }
+    std::reverse(path.begin(), path.end());
+  }
+} _aStarContext;
+
 /**
  * @class AStar
  * @brief A* algorithm
  *
  * This class represents the A* algorithm. It is used to find the shortest path between two points in a graph.
+ * The graph is borrowed, not copied: it must outlive the AStar instance. A single instance can answer several queries
+ * and reuses its search buffers between them.
  */
 class AStar {
 public:
   using node = _aStarNode;
   using conflict = _aStarConflict;
+  using context = _aStarContext;
+  using stats = _searchStats;
+
+  /**
+   * @brief Constructor of a reusable search context
+   * @param cityGraph The graph
+   */
+  AStar(const CityGraph &cityGraph);
 
   /**
    * @brief Constructor
@@ -85,21 +167,174 @@ public:
   AStar(CityGraph::point start, CityGraph::point end, const CityGraph &cityGraph);
 
   /**
-   * @brief Find the path
+   * @brief Find the path between the start and end points given to the constructor
    * @return The path
    */
   std::vector<node> findPath() {
     if (!processed)
       process();
-    return path;
+    return ctx.path;
+  }
+
+  /**
+   * @brief Find the path between two points, reusing the buffers of the previous query
+   * @param start The start point
+   * @param end The end point
+   * @return The path, empty if none was found
+   */
+  const std::vector<node> &findPath(CityGraph::point start, CityGraph::point end);
+
+  /**
+   * @brief Find a path between two points within a wall-clock budget (ARA*)
+   *
+   * A first path is found quickly with an inflated heuristic, then improved while time remains. The returned path is
+   * the best one found, and getSuboptimalityBound tells how far from optimal it can be.
+   *
+   * @param start The start point
+   * @param end The end point
+   * @param timeBudget The wall-clock budget in seconds
+   * @return The path, empty if none was found within the budget
+   */
+  const std::vector<node> &findPathAnytime(CityGraph::point start, CityGraph::point end,
+                                           double timeBudget = ASTAR_TIME_BUDGET);
+
+  /**
+   * @brief Get the suboptimality bound of the last path found
+   * @return The bound, 1 if the path is optimal
+   */
+  double getSuboptimalityBound() const { return ctx.suboptimalityBound; }
+
+  /**
+   * @brief Find the paths from one start point to many end points with a single search
+   *
+   * The search is a Dijkstra from the start point at speed 0 that stops once every end point has been reached, so the
+   * paths share one search tree. Each path is the cheapest one to its end point, like with findPath.
+   *
+   * @param start The start point
+   * @param ends The end points
+   * @param costs If not nullptr, filled with the travel time of each path
+   * @return The paths, in the order of the end points, empty for the end points that were not reached
+   */
+  std::vector<std::vector<node>> findPaths(CityGraph::point start, const std::vector<CityGraph::point> &ends,
+                                           std::vector<double> *costs = nullptr);
+
+  /**
+   * @brief Find the path between two points with a bidirectional search
+   *
+   * The forward search starts from the start point at speed 0 and the backward search from the end point at speed 0,
+   * over the reverse adjacency of the graph. The two searches meet on a (graph point, speed bucket) pose. The search
+   * stops when the smallest f-score of one of the open sets is not lower than the best meeting cost, so the path is the
+   * cheapest one that stops at the end point.
+   *
+   * The goal differs from the one of findPath, which accepts any speed at the end point: the car must arrive at speed
+   * 0, so the path may be slower than the one of findPath, never faster.
+   *
+   * @param start The start point
+   * @param end The end point
+   * @return The path, empty if none was found
+   */
+  const std::vector<node> &findPathBidirectional(CityGraph::point start, CityGraph::point end);
+
+  /**
+   * @brief Find a path between two points with a two-level search
+   *
+   * The route of road segments is found first on the road graph (CityGraph::getRoadGraph), then the kinematic search
+   * only follows the edges inside that corridor, widened by HIERARCHICAL_CORRIDOR_WIDTH segments. The search effort
+   * depends on the length of the route rather than on the size of the map. The path can be slower than the one of
+   * findPath, when the fastest route leaves the corridor, so it is not stored in the route cache. If there is no path
+   * inside the corridor, the whole graph is searched.
+   *
+   * @param start The start point
+   * @param end The end point
+   * @return The path, empty if none was found
+   */
+  const std::vector<node> &findPathHierarchical(CityGraph::point start, CityGraph::point end);
+
+  /**
+   * @brief Use a route cache for the unidirectional searches (findPath)
+   *
+   * On a hit the path is returned without searching and no node is expanded. On a miss the path found is stored.
+   *
+   * @param cache The cache, borrowed: it must outlive the searches. nullptr to disable the cache
+   */
+  void setCache(RouteCache *cache) { this->cache = cache; }
+
+  /**
+   * @brief Choose the heuristic of the next searches
+   * @param useLandmarks If true and the graph has landmarks, use the ALT heuristic, else the Euclidean one
+   */
+  void setUseLandmarks(bool useLandmarks) { this->useLandmarks = useLandmarks; }
+
+  /**
+   * @brief Choose the state identity of the next unidirectional searches (findPath)
+   * @param dominancePruning If true, merge the states at the same point and speed bucket whatever their arrival edge
+   * (PoseStateKey), else keep one state per arrival edge (EdgeStateKey)
+   */
+  void setDominancePruning(bool dominancePruning) { this->dominancePruning = dominancePruning; }
+
+  /**
+   * @brief Get the travel time of the last path found
+   * @return The travel time in seconds
+   */
+  double getPathCost() const { return ctx.pathCost; }
+
+  /**
+   * @brief Get the number of nodes expanded by the last search
+   * @return The number of expanded nodes
+   */
+  int getNumExpansions() const { return lastStats.numExpansions; }
+
+  /**
+   * @brief Get the statistics of the last search, both sides of a bidirectional search added up
+   * @return The statistics
+   */
+  const stats &getStats() const { return lastStats; }
+
+  /**
+   * @brief Get the statistics of every search since the construction or the last resetStats
+   * @return The statistics added up
+   */
+  const stats &getTotalStats() const { return totalStats; }
+
+  /**
+   * @brief Reset the statistics added up by getTotalStats
+   */
+  void resetStats() { totalStats = stats(); }
+
+  /**
+   * @brief Get the number of states reached by the last search
+   * @return The number of states
+   */
+  int getNumStates() const { return ctx.nodes.size() + backwardCtx.nodes.size(); }
+
+  /**
+   * @brief Get the memory held by the node tables
+   * @return The number of bytes
+   */
+  std::size_t getMemoryUsage() const {
+    return ctx.nodes.getMemoryUsage() + backwardCtx.nodes.getMemoryUsage() + forwardPoses.getMemoryUsage() +
+           backwardPoses.getMemoryUsage();
   }
 
 private:
   bool processed = false;
+  bool useLandmarks = true;
+  bool dominancePruning = true;
+  RouteCache *cache = nullptr;
   node start;
   node end;
-  std::vector<node> path;
-  CityGraph graph;
+  const CityGraph &graph;
+  context ctx;
+  context backwardCtx;        // Backward search of findPathBidirectional, empty after a unidirectional search
+  NodeTable forwardPoses;     // Best forward record per (point, speed bucket), edge -1
+  NodeTable backwardPoses;    // Best backward record per (point, speed bucket), edge -1
+  std::vector<char> corridor; // Road graph nodes of the corridor of findPathHierarchical, by node id
+  stats lastStats;
+  stats totalStats;
 
   void process();
+  void collectStats(std::chrono::steady_clock::time_point startTime, bool found);
+  void processBidirectional();
+  template <typename Heuristic>
+  void runBidirectional(int startId, int endId, const Heuristic &forwardHeuristic, const Heuristic &backwardHeuristic);
 };
@@ -0,0 +1,71 @@
+/**
+ * @file arena.h
+ * @brief Pooled arena allocator
+ *
+ * This file contains the Arena class, a pool of objects allocated in fixed-size blocks. It is used for the records of
+ * the searches, which are allocated by the thousand and all released together at the end of a query.
+ */
+#pragma once
+
+#include "config.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @class Arena
+ * @brief A pool of objects allocated in fixed-size blocks
+ *
+ * Objects are addressed by a dense index. Blocks are never moved, so references to allocated objects stay valid while
+ * the arena grows. reset() releases every object at once but keeps the blocks, so the next use does not allocate again.
+ *
+ * @tparam T The type of the objects, must be default constructible
+ * @tparam BLOCK_SIZE The number of objects per block
+ */
+template <typename T, std::size_t BLOCK_SIZE = ARENA_BLOCK_SIZE> class Arena {
+public:
+  /**
+   * @brief Allocate a new object
+   * @return The index of the object
+   */
+  int allocate() {
+    if (count == blocks.size() * BLOCK_SIZE)
+      blocks.push_back(std::make_unique<T[]>(BLOCK_SIZE));
+
+    T &object = (*this)[count];
+    object = T();
+    return (int)count++;
+  }
+
+  /**
+   * @brief Release every object, keeping the blocks for the next use
+   */
+  void reset() { count = 0; }
+
+  /**
+   * @brief Release every object and free the blocks
+   */
+  void release() {
+    count = 0;
+    blocks.clear();
+  }
+
+  /**
+   * @brief Get the number of allocated objects
+   * @return The number of objects
+   */
+  int size() const { return (int)count; }
+
+  /**
+   * @brief Get the memory held by the arena
+   * @return The number of bytes of the blocks
+   */
+  std::size_t getMemoryUsage() const { return blocks.size() * BLOCK_SIZE * sizeof(T); }
+
+  T &operator[](int index) { return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+  const T &operator[](int index) const { return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+
+private:
+  std::vector<std::unique_ptr<T[]>> blocks;
+  std::size_t count = 0;
+};
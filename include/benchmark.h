@@ -0,0 +1,151 @@
+/**
+ * @file benchmark.h
+ * @brief Benchmarks of the path planning algorithms
+ *
+ * This file contains the declaration of the Benchmark class. It times the search algorithms on a loaded city graph
+ * with reproducible random queries, so that results can be compared between two versions of the code.
+ */
+#pragma once
+
+#include "cityGraph.h"
+#include "conflictDetector.h"
+#include "config.h"
+#include "reservationIndex.h"
+#include <utility>
+#include <vector>
+
+/**
+ * @class Benchmark
+ * @brief Benchmarks of the path planning algorithms
+ *
+ * This class runs the benchmarks on a city graph. Every benchmark logs its results with spdlog. The random queries
+ * only depend on the seed and the graph, so two runs on the same map use the same queries.
+ */
+class Benchmark {
+public:
+  using query = std::pair<CityGraph::point, CityGraph::point>;
+
+  /**
+   * @brief Constructor
+   * @param cityGraph The city graph, borrowed: it must outlive the benchmark
+   * @param seed The seed of the random queries
+   */
+  Benchmark(const CityGraph &cityGraph, unsigned int seed = BENCHMARK_SEED) : graph(cityGraph), seed(seed) {}
+
+  /**
+   * @brief Run every benchmark
+   * @param numQueries The number of queries per benchmark
+   */
+  void run(int numQueries);
+
+  /**
+   * @brief Measure the A* expansions per second on random start/end queries
+   * @param numQueries The number of queries
+   */
+  void benchmarkSearch(int numQueries);
+
+  /**
+   * @brief Compare the bidirectional search with the unidirectional one on the same queries
+   * @param numQueries The number of queries
+   */
+  void benchmarkBidirectional(int numQueries);
+
+  /**
+   * @brief Compare the anytime A* (ARA*) with the optimal A* on the same queries
+   * @param numQueries The number of queries
+   * @param timeBudget The wall-clock budget of each anytime query in seconds
+   */
+  void benchmarkAnytime(int numQueries, double timeBudget);
+
+  /**
+   * @brief Compare the states of A* with and without dominance pruning on the same queries
+   * @param numQueries The number of queries
+   */
+  void benchmarkDominance(int numQueries);
+
+  /**
+   * @brief Compare the expansions of A* with the ALT heuristic and with the Euclidean heuristic on the same queries
+   * @param numQueries The number of queries
+   */
+  void benchmarkLandmarks(int numQueries);
+
+  /**
+   * @brief Compare the hierarchical search with the search on the whole graph on the same queries
+   * @param numQueries The number of queries
+   */
+  void benchmarkHierarchical(int numQueries);
+
+  /**
+   * @brief Compare one A* query per end point with a single one-to-many search from a common start point
+   * @param numQueries The number of end points
+   */
+  void benchmarkOneToMany(int numQueries);
+
+  /**
+   * @brief Compare the A* queries without and with a warm route cache
+   * @param numQueries The number of queries
+   */
+  void benchmarkRouteCache(int numQueries);
+
+  /**
+   * @brief Compare the batch route planner on one thread and on every planner thread
+   * @param numQueries The number of routes
+   */
+  void benchmarkPlanner(int numQueries);
+
+  /**
+   * @brief Compare the speed transitions computed on the fly with the precomputed tables, on every edge and entry speed
+   *
+   * The transitions of the edges shorter than TRANSITION_LENGTH_RESOLUTION are also checked against the computed ones.
+   *
+   * @param numPasses The number of passes over the edges
+   */
+  void benchmarkSuccessors(int numPasses);
+
+  /**
+   * @brief Compare the grid, SIMD, parallel and incremental conflict checks with the brute-force one on random paths
+   * @param numAgents The number of cars
+   * @param numSteps The number of time steps
+   */
+  void benchmarkConflicts(int numAgents, int numSteps);
+
+  /**
+   * @brief Compare the reservation index with a scan of the constraints of each time bucket on random edge traversals
+   * @param numConstraints The number of constraints
+   * @param numEdges The number of edge traversals
+   */
+  void benchmarkReservations(int numConstraints, int numEdges);
+
+  /**
+   * @brief Compare the OCBS low levels, kinematic A* and safe intervals, on queries blocked by slower cars ahead
+   *
+   * Each query is constrained by the positions of slower cars driving its own unconstrained route ahead of it, the
+   * worst case of the constraint tree: the car has to slow down or wait behind them all the way.
+   *
+   * @param numQueries The number of queries
+   * @param numLeaders The number of slower cars ahead of each query
+   */
+  void benchmarkSafeIntervals(int numQueries, int numLeaders);
+
+  /**
+   * @brief Compare the optimal OCBS low level with the focal one of ECBS on queries among slower cars ahead
+   * @param numQueries The number of queries
+   * @param numLeaders The number of slower cars ahead of each query, counted as conflicts
+   * @param weight The suboptimality factor of the focal search
+   */
+  void benchmarkFocal(int numQueries, int numLeaders, double weight);
+
+  /**
+   * @brief Compare the indexed heap open set with a priority queue ordered through an f-score hash map
+   * @param numOperations The number of push operations
+   */
+  void benchmarkOpenSet(int numOperations);
+
+private:
+  const CityGraph &graph;
+  unsigned int seed;
+
+  std::vector<query> createQueries(int numQueries) const;
+  ConflictDetector::paths createTrajectories(int numAgents, int numSteps) const;
+  int addLeaders(const std::vector<sf::Vector2f> &samples, int numLeaders, ReservationIndex *index) const;
+};
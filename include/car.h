@@ -41,13 +41,13 @@ public:
    * @param graph The graph
    * @param cityMap The city map
    */
-  void chooseRandomStartEndPath(CityGraph &graph, CityMap &cityMap);
+  void chooseRandomStartEndPath(const CityGraph &graph, const CityMap &cityMap);
 
   /**
    * @brief Assign a path to the car
    * @param path The path
    */
-  void assignPath(std::vector<AStar::node> path, CityGraph &graph);
+  void assignPath(std::vector<AStar::node> path, const CityGraph &graph);
 
   /**
    * @brief Assign an existing path to the car
@@ -96,7 +96,7 @@ public:
    * @param graph The graph
    * @return The average speed
    */
-  double getAverageSpeed(CityGraph &graph);
+  double getAverageSpeed(const CityGraph &graph);
 
   /**
    * @brief Get the remaining time to reach the end point
@@ -116,6 +116,12 @@ public:
    */
   double getPathTime();
 
+  /**
+   * @brief Get the exact duration of the planned path, waits included, before it is sampled every SIM_STEP_TIME
+   * @return The duration, the sampled time for a path assigned as positions
+   */
+  double getPathDuration() const { return pathDuration; }
+
   /**
    * @brief Get the remaining distance to reach the end point
    * @return The remaining distance
@@ -144,7 +150,7 @@ public:
    * @brief Get the path of the car
    * @return The path
    */
-  std::vector<sf::Vector2f> getPath() { return path; }
+  const std::vector<sf::Vector2f> &getPath() const { return path; }
 
   /**
    * @brief Get the path of the car from the A* algorithm
@@ -163,6 +169,7 @@ private:
   _cityGraphPoint end;
   std::vector<sf::Vector2f> path;
   std::vector<AStar::node> aStarPath;
+  double pathDuration = 0;
   int currentPoint = 0;
   bool debug = false;
   sf::Color color;
@@ -173,7 +180,7 @@ private:
  * @param car1 The first car
  * @param car2 The second car
  */
-bool carsCollided(Car car1, Car car2, int time);
+bool carsCollided(const Car &car1, const Car &car2, int time);
 
 /**
  * @brief Check if two cars have a conflict
@@ -8,7 +8,10 @@
 
 #include "cityMap.h"
 #include "config.h"
+#include "roadGraph.h"
+#include <random>
 #include <unordered_set>
+#include <utility>
 
 class DubinsInterpolator;
 
@@ -53,6 +56,24 @@ typedef struct _cityGraphNeighbor {
   }
 } _cityGraphNeighbor;
 
+/**
+ * @struct _cityGraphEdge
+ * @brief An edge of the indexed city graph
+ *
+ * This struct represents an edge of the city graph once the graph is indexed. The points are referenced by their id,
+ * and the length and interpolator of the Dubins path are resolved once for all.
+ */
+typedef struct _cityGraphEdge {
+  int from;                         /**< \brief The id of the source point */
+  int to;                           /**< \brief The id of the target point */
+  _cityGraphNeighbor neighbor;      /**< \brief The neighbor data of the edge */
+  double distance;                  /**< \brief The length of the Dubins path of the edge */
+  DubinsInterpolator *interpolator; /**< \brief The interpolator of the Dubins path of the edge */
+  int maxSpeedBucket = -1;          /**< \brief The highest speed bucket allowed on the edge */
+  int transitions = -1;             /**< \brief The speed transition table of the edge, see getSpeedTransitions */
+  int reverseTransitions = -1;      /**< \brief The reverse speed transition table of the edge */
+} _cityGraphEdge;
+
 namespace std {
 template <> struct hash<_cityGraphPoint> {
   std::size_t operator()(const _cityGraphPoint &point) const {
@@ -86,6 +107,7 @@ class CityGraph {
 public:
   using point = _cityGraphPoint;
   using neighbor = _cityGraphNeighbor;
+  using edge = _cityGraphEdge;
 
   /**
    * @brief Create a city graph
@@ -100,13 +122,13 @@ public:
    * @brief Get neighbors map
    * @return Neighbors map
    */
-  std::unordered_map<point, std::vector<neighbor>> getNeighbors() const { return neighbors; }
+  const std::unordered_map<point, std::vector<neighbor>> &getNeighbors() const { return neighbors; }
 
   /**
    * @brief Get graph points
    * @return Graph points
    */
-  std::unordered_set<point> getGraphPoints() const { return graphPoints; }
+  const std::unordered_set<point> &getGraphPoints() const { return graphPoints; }
 
   /**
    * @brief Get random point
@@ -114,6 +136,13 @@ public:
    */
   point getRandomPoint() const;
 
+  /**
+   * @brief Get random point using a given random generator
+   * @param gen The random generator
+   * @return Random point
+   */
+  point getRandomPoint(std::mt19937 &gen) const;
+
   /**
    * @brief Get the height of the city graph
    * @return The height of the city graph
@@ -132,23 +161,209 @@ public:
    * @param point2 The second point
    * @return The DubinsInterpolator for the path between the two points
    */
-  DubinsInterpolator *getInterpolator(const point &point1, const neighbor &point2) {
-    std::pair<point, neighbor> key = {point1, point2};
-    if (interpolators.find(key) != interpolators.end()) {
-      return interpolators[key];
+  DubinsInterpolator *getInterpolator(const point &point1, const neighbor &point2) const {
+    auto it = interpolators.find({point1, point2});
+    if (it != interpolators.end()) {
+      return it->second;
     }
     return nullptr;
   }
 
+  /**
+   * @brief Get the id of a point in the indexed graph
+   * @param p The point
+   * @return The id of the point, -1 if it is not in the graph
+   */
+  int getPointId(const point &p) const {
+    auto it = pointIds.find(p);
+    return it != pointIds.end() ? it->second : -1;
+  }
+
+  /**
+   * @brief Get a point of the indexed graph
+   * @param id The id of the point
+   * @return The point
+   */
+  const point &getPoint(int id) const { return points[id]; }
+
+  /**
+   * @brief Get the number of points of the indexed graph
+   * @return The number of points
+   */
+  int getNumPoints() const { return points.size(); }
+
+  /**
+   * @brief Get the number of edges of the indexed graph
+   * @return The number of edges
+   */
+  int getNumEdges() const { return edges.size(); }
+
+  /**
+   * @brief Get an edge of the indexed graph
+   * @param id The id of the edge
+   * @return The edge
+   */
+  const edge &getEdge(int id) const { return edges[id]; }
+
+  /**
+   * @brief Get the id of the first outgoing edge of a point. The outgoing edges of a point have consecutive ids
+   * @param pointId The id of the point
+   * @return The id of the first outgoing edge
+   */
+  int getFirstEdge(int pointId) const { return edgeOffsets[pointId]; }
+
+  /**
+   * @brief Get the id following the last outgoing edge of a point
+   * @param pointId The id of the point
+   * @return The id following the last outgoing edge
+   */
+  int getEndEdge(int pointId) const { return edgeOffsets[pointId + 1]; }
+
+  /**
+   * @brief Get the position of the first incoming edge of a point in the reverse adjacency
+   * @param pointId The id of the point
+   * @return The position of the first incoming edge, to be resolved with getReverseEdge
+   */
+  int getFirstReverseEdge(int pointId) const { return reverseEdgeOffsets[pointId]; }
+
+  /**
+   * @brief Get the position following the last incoming edge of a point in the reverse adjacency
+   * @param pointId The id of the point
+   * @return The position following the last incoming edge
+   */
+  int getEndReverseEdge(int pointId) const { return reverseEdgeOffsets[pointId + 1]; }
+
+  /**
+   * @brief Get an edge of the reverse adjacency
+   * @param position The position in the reverse adjacency
+   * @return The id of the edge
+   */
+  int getReverseEdge(int position) const { return reverseEdges[position]; }
+
+  /**
+   * @brief Get the version of the graph
+   *
+   * The version changes every time the graph is built, and two graphs never share a version, so results computed on
+   * the graph can be invalidated by comparing versions.
+   *
+   * @return The version, 0 if the graph was never built
+   */
+  unsigned int getVersion() const { return version; }
+
+  /**
+   * @brief Get the exit speed buckets reachable from an entry speed bucket on an edge
+   *
+   * The tables are computed when the graph is indexed, from the acceleration limits of the cars, and shared between
+   * the edges of the same length class (TRANSITION_LENGTH_RESOLUTION, rounded down) and maximum speed. Rounding the
+   * length down and the exit speeds towards the entry speed only removes transitions, so every transition of a table
+   * is feasible on the edges that share it. The edges shorter than the resolution are not rounded down to length 0,
+   * which would forbid every speed change: their tables are computed from their exact length.
+   *
+   * @param e The edge
+   * @param speedBucket The entry speed bucket, or the exit speed bucket if reverse is true
+   * @param reverse If true, get the entry speed buckets from which an exit speed bucket is reachable
+   * @return The range of speed buckets, empty if the speed is not allowed on the edge
+   */
+  std::pair<const int *, const int *> getSpeedTransitions(const edge &e, int speedBucket, bool reverse = false) const {
+    if (speedBucket < 0 || speedBucket > e.maxSpeedBucket)
+      return {nullptr, nullptr};
+    int base = (reverse ? e.reverseTransitions : e.transitions) + speedBucket;
+    return {transitionBuckets.data() + transitionOffsets[base], transitionBuckets.data() + transitionOffsets[base + 1]};
+  }
+
+  /**
+   * @brief Get a lower bound of the time needed to traverse an edge
+   *
+   * The car can not go faster than the maximum speed of the edge nor than CAR_MAX_SPEED_MS on it.
+   *
+   * @param edgeId The id of the edge
+   * @return The time in seconds, infinite if the edge can not be used
+   */
+  double getMinTravelTime(int edgeId) const;
+
+  /**
+   * @brief Compute the lower bounds of the travel times from a point to every point (Dijkstra on getMinTravelTime)
+   * @param pointId The id of the source point
+   * @param reverse If true, compute the travel times from every point to the source point instead
+   * @return The travel times by point id, infinite for the points that can not be reached
+   */
+  std::vector<double> computeTravelTimes(int pointId, bool reverse = false) const;
+
+  /**
+   * @brief Choose landmarks and store the travel times from and to each of them, for the ALT heuristic
+   *
+   * The landmarks are chosen greedily, each one being the point the farthest from the already chosen ones. The memory
+   * used is 2 * numLandmarks doubles per point.
+   *
+   * @param numLandmarks The number of landmarks, 0 to remove them
+   */
+  void computeLandmarks(int numLandmarks = ALT_NUM_LANDMARKS);
+
+  /**
+   * @brief Get the road-level abstraction of the graph
+   * @return The graph of the road segments
+   */
+  const RoadGraph &getRoadGraph() const { return roadGraph; }
+
+  /**
+   * @brief Get the road segment of a point
+   * @param pointId The id of the point
+   * @return The id of the node of the road graph the point belongs to, -1 if unknown
+   */
+  int getRegion(int pointId) const { return regions[pointId]; }
+
+  /**
+   * @brief Get the number of landmarks
+   * @return The number of landmarks
+   */
+  int getNumLandmarks() const { return numLandmarks; }
+
+  /**
+   * @brief Get the landmark travel times of a point
+   * @param pointId The id of the point
+   * @return 2 * getNumLandmarks() values: for each landmark, the time from the landmark to the point, then the time
+   * from the point to the landmark
+   */
+  const double *getLandmarkTimes(int pointId) const { return landmarkTimes.data() + 2 * numLandmarks * pointId; }
+
 private:
   std::unordered_map<point, std::vector<neighbor>> neighbors;
   std::unordered_set<point> graphPoints;
 
   std::unordered_map<std::pair<point, neighbor>, DubinsInterpolator *> interpolators;
 
-  void linkPoints(const point &point1, const point &point2, int direction,
-                  bool subPoints); // direction: 0 -> point1 to point2, 1 -> point2 to point1, 2 -> both
+  // direction: 0 -> point1 to point2, 1 -> point2 to point1, 2 -> both. The regions are the road graph nodes the
+  // points belong to, the intermediate points belong to the region of point1
+  void linkPoints(const point &point1, const point &point2, int direction, bool subPoints, int region,
+                  int neighborRegion);
   bool canLink(const point &point1, const point &point2, double speed, double *distance) const;
+  void buildIndex();
+  void buildSpeedTransitions();
+
+  // Indexed graph: points by id, and outgoing edges grouped by source point
+  // (edgeOffsets has one more entry than points)
+  std::unordered_map<point, int> pointIds;
+  std::vector<point> points;
+  std::vector<edge> edges;
+  std::vector<int> edgeOffsets;
+  std::vector<int> reverseEdges; // Edge ids grouped by target point
+  std::vector<int> reverseEdgeOffsets;
+  std::vector<point> boundaryPoints; // Graph points outside the map, where the cars start and end
+
+  // Road-level abstraction: the road graph node of each point, while the graph is created then by point id
+  RoadGraph roadGraph;
+  std::unordered_map<point, int> pointRegions;
+  std::vector<int> regions;
+  unsigned int version = 0;
+
+  // Interned speed transition tables: for a table starting at offset t, the exit buckets of the entry bucket b are
+  // transitionBuckets[transitionOffsets[t + b]] to transitionBuckets[transitionOffsets[t + b + 1]]
+  std::vector<int> transitionOffsets;
+  std::vector<int> transitionBuckets;
+
+  // ALT landmarks: 2 * numLandmarks travel times per point, see getLandmarkTimes
+  int numLandmarks = 0;
+  std::vector<double> landmarkTimes;
 
   double width;
   double height;
@@ -51,7 +51,8 @@ constexpr double MOVE_SPEED = 0.01;                      // Camera movement spee
 constexpr double SIM_STEP_TIME = 0.05;                   // Simulation time step in seconds
 constexpr int CBS_PRECISION_FACTOR = 1;                  // CBS precision factor (CBS_PRECISION_FACTOR * SIM_STEP_TIME should be reasonable)
 constexpr double CBS_MAX_SUB_TIME = 30;                  // Maximum sub-problem solving time in seconds
-constexpr double CBS_MAX_OPENSET_SIZE = 5;               // Maximum size of CBS open set
+constexpr double CBS_MAX_OPENSET_SIZE = 5;               // Maximum memory of the CBS open set in GB
+constexpr int CBS_MAX_NODES = 10000;                     // Maximum number of CBS constraint tree nodes expanded
 
 constexpr double OCBS_CONFLICT_RANGE = SIM_STEP_TIME * 5; // Conflict detection range for OCBS algorithm
 
@@ -80,5 +81,43 @@ constexpr double CAR_WIDTH = 1.6;                       // Vehicle width in mete
 // ============================================================================
 constexpr double COLLISION_SAFETY_FACTOR = 1.1;         // Safety margin multiplier for collision detection
 constexpr int ASTAR_MAX_ITERATIONS = 100000;            // Maximum iterations for A* pathfinding
+constexpr int ONE_TO_MANY_MAX_ITERATIONS = 1000000;     // Maximum iterations for a one-to-many search
+constexpr double ASTAR_TIME_BUDGET = 1.0;               // Wall-clock budget of an anytime A* search in seconds
+constexpr double ARA_INITIAL_WEIGHT = 3.0;              // Heuristic weight of the first anytime A* solution
+constexpr double ARA_WEIGHT_STEP = 0.5;                 // Decrease of the heuristic weight between anytime iterations
+constexpr bool SEARCH_STATS_TIMING = true;              // Time the successor generation and the constraint checks
+constexpr int ASTAR_HEAP_ARITY = 4;                     // Number of children per node in the A* open set heap
+constexpr int NODE_TABLE_INITIAL_SLOTS = 1024;          // Initial number of slots of the A* node table (power of two)
+constexpr int CONFLICT_SIMD_MAX_CARS = 1000;            // Largest fleet checked pairwise with SIMD instead of the grid
+constexpr int CONFLICT_SIMD_WINDOW_STEPS = 64;          // Steps copied at once to the SIMD trajectory buffer
+constexpr int CONFLICT_SLICE_STEPS = 64;                // Steps per task of the parallel conflict check
+constexpr int CONFLICT_NUM_THREADS = 0;                 // Number of conflict check threads, 0 for the hardware threads
+constexpr int RESERVATION_SCAN_ENTRIES = 64;            // Constraints of a time bucket scanned without the cell search
+constexpr double SIPP_WAIT_STEP = OCBS_CONFLICT_RANGE;  // Time between two departures tried from a stopped state
+constexpr int SIPP_MAX_WAIT_STEPS = 40;                 // Maximum number of waits tried from a stopped state
+constexpr bool OCBS_SAFE_INTERVALS = false;             // Default OCBS low level: SIPP if true, kinematic A* if not
+constexpr double ECBS_SUBOPTIMALITY = 1.0;              // Default OCBS suboptimality factor, above 1 for ECBS
+constexpr int TRAJECTORY_LANES = 8;                     // Row padding of the trajectory buffers, the widest SIMD width
+constexpr int ARENA_BLOCK_SIZE = 4096;                  // Number of objects per block of the pooled arenas
 constexpr int NUM_SPEED_DIVISIONS = 5;                  // Number of speed divisions for trajectory planning
+constexpr double TRANSITION_LENGTH_RESOLUTION = 0.1;    // Edge length classes of the speed transition tables (m)
 constexpr double GRAPH_POINT_DISTANCE = 15.0;           // Distance between graph nodes in meters
+constexpr int HIERARCHICAL_CORRIDOR_WIDTH = 1;          // Road segments added around the coarse route of a search
+constexpr int ALT_NUM_LANDMARKS = 8;                    // Number of landmarks of the A* heuristic, 0 to disable
+constexpr int PLANNER_NUM_THREADS = 0;                  // Number of route planning threads, 0 for the hardware threads
+constexpr int ROUTE_CACHE_CAPACITY = 4096;              // Maximum number of routes kept by the route cache
+
+// ============================================================================
+// Benchmark Configuration
+// ============================================================================
+constexpr unsigned int BENCHMARK_SEED = 42;             // Seed of the random queries, so runs can be compared
+constexpr int BENCHMARK_NUM_QUERIES = 20;               // Default number of queries per benchmark
+constexpr int BENCHMARK_OPEN_SET_OPERATIONS = 1000000;  // Number of operations of the open set micro-benchmark
+constexpr double BENCHMARK_ANYTIME_BUDGET = 0.05;       // Wall-clock budget of the anytime A* queries in seconds
+constexpr int BENCHMARK_SUCCESSOR_PASSES = 10;          // Passes over every edge of the successor micro-benchmark
+constexpr int BENCHMARK_CONFLICT_MAX_AGENTS = 2000;     // Largest fleet of the conflict benchmark, halved down
+constexpr int BENCHMARK_CONFLICT_STEPS = 600;           // Number of time steps of the conflict detection benchmark
+constexpr int BENCHMARK_RESERVATIONS = 20000;           // Number of constraints of the reservation index benchmark
+constexpr int BENCHMARK_RESERVATION_EDGES = 100000;     // Number of edge traversals checked by the same benchmark
+constexpr int BENCHMARK_SAFE_INTERVAL_LEADERS = 4;      // Slower cars ahead of each safe interval benchmark query
+constexpr double BENCHMARK_ECBS_SUBOPTIMALITY = 1.1;    // Suboptimality factor of the focal low level benchmark
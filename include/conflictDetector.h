@@ -0,0 +1,184 @@
+/**
+ * @file conflictDetector.h
+ * @brief Detection of the conflicts between the sampled paths of the cars
+ *
+ * This file contains the declaration of the ConflictDetector class, the conflict check of the OCBS high level. The
+ * paths are sampled every SIM_STEP_TIME, and two cars conflict when their positions at the same step are closer than
+ * the collision range.
+ */
+#pragma once
+
+#include "config.h"
+#include "threadPool.h"
+#include "trajectoryBuffer.h"
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <vector>
+
+/**
+ * @struct _conflictDetectorPair
+ * @brief Two cars that conflict, with the first step of their conflict
+ */
+typedef struct _conflictDetectorPair {
+  int car1; /**< \brief The lower index of the conflicting cars */
+  int car2; /**< \brief The higher index of the conflicting cars */
+  int time; /**< \brief The first step at which they conflict */
+
+  bool operator<(const _conflictDetectorPair &other) const {
+    if (time != other.time)
+      return time < other.time;
+    return car1 < other.car1 || (car1 == other.car1 && car2 < other.car2);
+  }
+} _conflictDetectorPair;
+
+/**
+ * @class ConflictDetector
+ * @brief Finds the conflicts of a set of sampled paths with a uniform grid broad phase
+ *
+ * At every time step, the cars are binned in a grid of cells as large as the collision range, so a car is only tested
+ * against the cars of its cell and of the 8 neighboring cells instead of every other car. The cells are hashed into a
+ * bucket array rebuilt in place at every step, so no memory is allocated once the buffers have grown.
+ *
+ * A car whose path is over has arrived: it has left the map through a boundary point, so it is not tested anymore.
+ *
+ * The first conflict is the one of the earliest step, then of the lowest car index, then of the lowest other car
+ * index: the same as the brute-force check over every pair (findFirstConflictBruteForce).
+ *
+ * With a thread pool (setThreadPool), the horizon is split into slices of CONFLICT_SLICE_STEPS steps scanned in
+ * parallel. The earliest step with a conflict found so far is shared, so the slices after it stop, and the conflict of
+ * the earliest slice is reported: the result does not depend on the number of threads.
+ *
+ * A set of conflicting pairs sorted in the same order (findConflicts) can be kept up to date when one path changes by
+ * checking that car only (updateConflicts), in O(T x N) instead of O(T x N^2); its first pair is the first conflict.
+ */
+class ConflictDetector {
+public:
+  using path = TrajectoryBuffer::path;
+  using paths = TrajectoryBuffer::paths;
+  using pair = _conflictDetectorPair;
+
+  /**
+   * @brief Constructor
+   * @param range The distance under which two cars conflict
+   */
+  ConflictDetector(double range = CAR_LENGTH * COLLISION_SAFETY_FACTOR) : range(range), range2(range * range) {}
+
+  /**
+   * @brief Scan the time slices in parallel on a thread pool in findFirstConflict
+   * @param pool The thread pool, borrowed: it must outlive the detector, nullptr to scan sequentially
+   */
+  void setThreadPool(ThreadPool *pool) { this->pool = pool; }
+
+  /**
+   * @brief Find the first conflict of a set of paths
+   * @param paths The positions of each car at each step
+   * @param car1 Set to the lower index of the conflicting cars
+   * @param car2 Set to the higher index of the conflicting cars
+   * @param time Set to the step of the conflict
+   * @return True if there is a conflict
+   */
+  bool findFirstConflict(const paths &paths, int *car1, int *car2, int *time);
+
+  /**
+   * @brief Find the first conflict of a set of paths by testing every pair of cars, for reference
+   * @param paths The positions of each car at each step
+   * @param car1 Set to the lower index of the conflicting cars
+   * @param car2 Set to the higher index of the conflicting cars
+   * @param time Set to the step of the conflict
+   * @return True if there is a conflict
+   */
+  bool findFirstConflictBruteForce(const paths &paths, int *car1, int *car2, int *time) const;
+
+  /**
+   * @brief Find the first conflict of a set of paths by testing every pair of cars with the SIMD kernel
+   *
+   * The paths are copied to a time-major trajectory buffer, then each car is compared with all the following cars of
+   * the step at once (findFirstInRange).
+   *
+   * @param paths The positions of each car at each step
+   * @param car1 Set to the lower index of the conflicting cars
+   * @param car2 Set to the higher index of the conflicting cars
+   * @param time Set to the step of the conflict
+   * @return True if there is a conflict
+   */
+  bool findFirstConflictSimd(const paths &paths, int *car1, int *car2, int *time);
+
+  /**
+   * @brief Find the first conflict of a set of paths with the grid broad phase
+   * @param paths The positions of each car at each step
+   * @param car1 Set to the lower index of the conflicting cars
+   * @param car2 Set to the higher index of the conflicting cars
+   * @param time Set to the step of the conflict
+   * @return True if there is a conflict
+   */
+  bool findFirstConflictGrid(const paths &paths, int *car1, int *car2, int *time);
+
+  /**
+   * @brief Find the first conflict of a set of paths by scanning slices of the horizon on a thread pool
+   * @param paths The positions of each car at each step
+   * @param pool The thread pool
+   * @param car1 Set to the lower index of the conflicting cars
+   * @param car2 Set to the higher index of the conflicting cars
+   * @param time Set to the step of the conflict
+   * @return True if there is a conflict
+   */
+  bool findFirstConflictParallel(const paths &paths, ThreadPool &pool, int *car1, int *car2, int *time);
+
+  /**
+   * @brief Find every pair of cars that conflict at least once, on the thread pool if any
+   * @param paths The positions of each car at each step
+   * @param conflicts Set to the conflicting pairs, sorted by first step, then car indices
+   */
+  void findConflicts(const paths &paths, std::vector<pair> *conflicts);
+
+  /**
+   * @brief Update the conflicting pairs after the path of one car changed
+   * @param paths The positions of each car at each step, with the new path of the car
+   * @param car The car whose path changed
+   * @param conflicts The sorted conflicting pairs of the previous paths, updated in place
+   */
+  void updateConflicts(const paths &paths, int car, std::vector<pair> *conflicts) const;
+
+  /**
+   * @brief Count the pairs of cars that conflict at least once
+   * @param paths The positions of each car at each step
+   * @return The number of pairs
+   */
+  int countConflictingPairs(const paths &paths);
+
+private:
+  double range;
+  float range2;                   // Squared range, the distances are compared squared in float everywhere
+  TrajectoryBuffer trajectories;
+  std::vector<int> bucketOffsets; // First car of each bucket in bucketCars, one more entry than buckets
+  std::vector<int> bucketCars;    // Active cars grouped by bucket, in increasing index order
+  std::vector<int> carBuckets;    // Bucket of each car at the current step, -1 if it has arrived
+  std::vector<int> fillBuffer;    // Next free position of each bucket while the grid is built
+  ThreadPool *pool = nullptr;
+  std::vector<ConflictDetector> sliceDetectors; // Buffers of each thread of the parallel scan
+  std::vector<int> sliceConflicts;              // Conflict of each slice as car1, car2, time, -1 if none
+
+  bool collide(const sf::Vector2f &a, const sf::Vector2f &b) const {
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    return dx * dx + dy * dy < range2;
+  }
+
+  void getCell(const sf::Vector2f &position, long long *x, long long *y) const;
+  int getBucket(long long x, long long y) const;
+  void buildGrid(const paths &paths, int time);
+
+  // Scan the steps [firstStep, endStep), stopping at the first step not before bound if given
+  bool scanSteps(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound, int *car1, int *car2,
+                 int *time);
+  bool scanSimd(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound, int *car1, int *car2,
+                int *time);
+  bool scanGrid(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound, int *car1, int *car2,
+                int *time);
+
+  // Append the conflicting pairs of the steps [firstStep, endStep) with their first step in the range, unsorted
+  void collectConflicts(const paths &paths, int firstStep, int endStep, std::vector<pair> *conflicts);
+
+  // Call visit(other) for every active car in the 9 cells around a car, possibly more than once
+  template <typename Visit> void forEachNeighbor(const paths &paths, int car, int time, Visit &&visit) const;
+};
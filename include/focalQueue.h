@@ -0,0 +1,156 @@
+/**
+ * @file focalQueue.h
+ * @brief Open and focal lists of a bounded-suboptimal search
+ *
+ * This file contains the FocalQueue class, the open list of the ECBS mode of OCBS, at the high level (constraint tree
+ * nodes) and at the low level (search states).
+ */
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * @class FocalQueue
+ * @brief An open list ordered by lower bound, with the focal list of the items within a factor of the best bound
+ *
+ * Each item has a lower bound of the cost of the solutions through it, a cost and a focal key (the number of conflicts
+ * for ECBS). The focal list holds the items whose cost is at most weight times the smallest lower bound of the queue,
+ * and pop returns the one with the smallest focal key, then the smallest cost. Since the bound only grows or shrinks
+ * with the smallest lower bound, the focal list is updated from the items sorted by cost, not rebuilt.
+ *
+ * Items are addressed by the handle returned by push, which stays valid until the item is popped or erased.
+ *
+ * @tparam T The type of the items
+ */
+template <typename T> class FocalQueue {
+public:
+  /**
+   * @brief Constructor
+   * @param weight The suboptimality factor, at least 1
+   */
+  FocalQueue(double weight = 1) : weight(weight) {}
+
+  /**
+   * @brief Remove every item and set the suboptimality factor
+   * @param weight The suboptimality factor, at least 1
+   */
+  void clear(double weight) {
+    this->weight = weight;
+    items.clear();
+    freeHandles.clear();
+    byLowerBound.clear();
+    byCost.clear();
+    focal.clear();
+    bound = -std::numeric_limits<double>::infinity();
+  }
+
+  /**
+   * @brief Check if the queue is empty
+   * @return True if the queue holds no item
+   */
+  bool empty() const { return byLowerBound.empty(); }
+
+  /**
+   * @brief Get the number of items
+   * @return The number of items
+   */
+  std::size_t size() const { return byLowerBound.size(); }
+
+  /**
+   * @brief Get the smallest lower bound of the items
+   * @return The lower bound, infinity if the queue is empty
+   */
+  double getLowerBound() const {
+    return empty() ? std::numeric_limits<double>::infinity() : byLowerBound.begin()->first;
+  }
+
+  /**
+   * @brief Insert an item
+   * @param value The item
+   * @param lowerBound The lower bound of the cost of the solutions through the item
+   * @param cost The cost of the item
+   * @param focalKey The key of the item in the focal list, smallest first
+   * @return The handle of the item
+   */
+  int push(T value, double lowerBound, double cost, double focalKey) {
+    int handle;
+    if (freeHandles.empty()) {
+      handle = items.size();
+      items.emplace_back();
+    } else {
+      handle = freeHandles.back();
+      freeHandles.pop_back();
+    }
+    items[handle] = {std::move(value), lowerBound, cost, focalKey};
+    byLowerBound.emplace(lowerBound, handle);
+    byCost.emplace(cost, handle);
+    updateBound();
+    if (cost <= bound)
+      focal.emplace(focalKey, cost, handle);
+    return handle;
+  }
+
+  /**
+   * @brief Remove the best item of the focal list, or the item of smallest lower bound if the focal list is empty
+   * @return The item
+   */
+  T pop() {
+    int handle = focal.empty() ? byLowerBound.begin()->second : std::get<2>(*focal.begin());
+    T value = std::move(items[handle].value);
+    erase(handle);
+    return value;
+  }
+
+  /**
+   * @brief Remove an item
+   * @param handle The handle of the item
+   */
+  void erase(int handle) {
+    const item &i = items[handle];
+    byLowerBound.erase({i.lowerBound, handle});
+    byCost.erase({i.cost, handle});
+    focal.erase({i.focalKey, i.cost, handle});
+    items[handle].value = T();
+    freeHandles.push_back(handle);
+    updateBound();
+  }
+
+private:
+  struct item {
+    T value;
+    double lowerBound;
+    double cost;
+    double focalKey;
+  };
+
+  double weight;
+  std::vector<item> items;
+  std::vector<int> freeHandles;
+  std::set<std::pair<double, int>> byLowerBound;
+  std::set<std::pair<double, int>> byCost;
+  std::set<std::tuple<double, double, int>> focal;
+  double bound = -std::numeric_limits<double>::infinity(); // The largest cost of the focal list
+
+  void updateBound() {
+    double newBound = empty() ? -std::numeric_limits<double>::infinity() : weight * getLowerBound();
+    if (newBound > bound) {
+      for (auto it = byCost.upper_bound({bound, std::numeric_limits<int>::max()});
+           it != byCost.end() && it->first <= newBound; it++) {
+        const item &i = items[it->second];
+        focal.emplace(i.focalKey, i.cost, it->second);
+      }
+    } else if (newBound < bound) {
+      for (auto it = byCost.upper_bound({newBound, std::numeric_limits<int>::max()});
+           it != byCost.end() && it->first <= bound; it++) {
+        const item &i = items[it->second];
+        focal.erase({i.focalKey, i.cost, it->second});
+      }
+    }
+    bound = newBound;
+  }
+};
@@ -0,0 +1,196 @@
+/**
+ * @file indexedHeap.h
+ * @brief Indexed d-ary heap with decrease-key
+ *
+ * This file contains the IndexedHeap class, the open list shared by the A* searches. Elements are dense integer ids
+ * and their key is stored inline, so comparisons never look anything up in a hash table.
+ */
+#pragma once
+
+#include "config.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class IndexedHeap
+ * @brief A min-heap of integer ids with decrease-key
+ *
+ * Each id can be in the heap at most once. The position of every id is tracked so that its key can be lowered in place
+ * (decrease-key) instead of pushing a duplicate entry. Ids must be non-negative and should be dense, since the position
+ * table is indexed by id.
+ *
+ * @tparam D The arity of the heap (number of children per node)
+ */
+template <int D = ASTAR_HEAP_ARITY> class IndexedHeap {
+  static_assert(D >= 2, "A heap needs at least two children per node");
+
+public:
+  /**
+   * @brief Remove every element, keeping the allocated memory
+   */
+  void clear() {
+    for (const auto &entry : heap)
+      position[entry.id] = -1;
+    heap.clear();
+  }
+
+  /**
+   * @brief Reserve memory for a number of ids
+   * @param numIds The number of ids
+   */
+  void reserve(std::size_t numIds) {
+    heap.reserve(numIds);
+    if (position.size() < numIds)
+      position.resize(numIds, -1);
+  }
+
+  /**
+   * @brief Check if the heap is empty
+   * @return True if the heap is empty
+   */
+  bool empty() const { return heap.empty(); }
+
+  /**
+   * @brief Get the number of elements in the heap
+   * @return The number of elements
+   */
+  std::size_t size() const { return heap.size(); }
+
+  /**
+   * @brief Check if an id is in the heap
+   * @param id The id
+   * @return True if the id is in the heap
+   */
+  bool contains(int id) const { return id < (int)position.size() && position[id] >= 0; }
+
+  /**
+   * @brief Get the key of an id in the heap
+   * @param id The id, must be in the heap
+   * @return The key
+   */
+  double getKey(int id) const { return heap[position[id]].key; }
+
+  /**
+   * @brief Get the id with the smallest key
+   * @return The id
+   */
+  int top() const { return heap.front().id; }
+
+  /**
+   * @brief Get the smallest key
+   * @return The key
+   */
+  double topKey() const { return heap.front().key; }
+
+  /**
+   * @brief Insert an id, or update its key if it is already in the heap
+   * @param id The id
+   * @param key The key
+   */
+  void push(int id, double key) {
+    if (id >= (int)position.size())
+      position.resize(id + 1, -1);
+
+    if (position[id] >= 0) {
+      update(id, key);
+      return;
+    }
+
+    heap.push_back({key, id});
+    position[id] = heap.size() - 1;
+    siftUp(heap.size() - 1);
+  }
+
+  /**
+   * @brief Lower the key of an id in the heap
+   * @param id The id, must be in the heap
+   * @param key The new key, must not be greater than the current one
+   */
+  void decreaseKey(int id, double key) {
+    heap[position[id]].key = key;
+    siftUp(position[id]);
+  }
+
+  /**
+   * @brief Change the key of an id in the heap, in either direction
+   * @param id The id, must be in the heap
+   * @param key The new key
+   */
+  void update(int id, double key) {
+    std::size_t index = position[id];
+    double oldKey = heap[index].key;
+    heap[index].key = key;
+    if (key < oldKey)
+      siftUp(index);
+    else
+      siftDown(index);
+  }
+
+  /**
+   * @brief Remove the id with the smallest key
+   * @return The removed id
+   */
+  int pop() {
+    int id = heap.front().id;
+    position[id] = -1;
+
+    if (heap.size() > 1) {
+      heap.front() = heap.back();
+      position[heap.front().id] = 0;
+      heap.pop_back();
+      siftDown(0);
+    } else {
+      heap.pop_back();
+    }
+
+    return id;
+  }
+
+private:
+  struct entry {
+    double key;
+    int id;
+  };
+
+  std::vector<entry> heap;   // The heap, stored level by level
+  std::vector<int> position; // The index of each id in the heap, -1 if absent
+
+  void siftUp(std::size_t index) {
+    entry moving = heap[index];
+    while (index > 0) {
+      std::size_t parent = (index - 1) / D;
+      if (heap[parent].key <= moving.key)
+        break;
+      heap[index] = heap[parent];
+      position[heap[index].id] = index;
+      index = parent;
+    }
+    heap[index] = moving;
+    position[moving.id] = index;
+  }
+
+  void siftDown(std::size_t index) {
+    entry moving = heap[index];
+    std::size_t size = heap.size();
+    while (true) {
+      std::size_t first = index * D + 1;
+      if (first >= size)
+        break;
+
+      std::size_t last = first + D < size ? first + D : size;
+      std::size_t best = first;
+      for (std::size_t child = first + 1; child < last; child++) {
+        if (heap[child].key < heap[best].key)
+          best = child;
+      }
+
+      if (moving.key <= heap[best].key)
+        break;
+      heap[index] = heap[best];
+      position[heap[index].id] = index;
+      index = best;
+    }
+    heap[index] = moving;
+    position[moving.id] = index;
+  }
+};
@@ -0,0 +1,928 @@
+/**
+ * @file kinematicSearch.h
+ * @brief Policy-based kinematic A* search
+ *
+ * This file contains the KinematicSearch class template, the A* loop shared by the single-agent search (AStar) and the
+ * OCBS low level. The parts that differ between the searches are compile-time policies:
+ * @li Heuristic: lower bound of the remaining time from a graph point
+ * @li Successors: the speeds reachable at the end of an edge, with the traversal durations
+ * @li Constraint: whether an edge traversal is allowed at a given time
+ * @li Goal: whether an expanded state ends the search
+ * @li Budget: when the search gives up
+ * @li StateKey: which states are merged in the node table (dominance pruning)
+ *
+ * A new variant only needs new policies, not a new copy of the loop. The variants that change the order of the
+ * expansions (anytime ARA*, focal ECBS, safe intervals) only bring their own open list and state keys: the
+ * relaxation of the edges (forEachTraversal, isTraversalAllowed, relaxState) is shared.
+ */
+#pragma once
+
+#include "aStar.h"
+#include "cityGraph.h"
+#include "config.h"
+#include "focalQueue.h"
+#include "searchStats.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class EuclideanHeuristic
+ * @brief Straight-line distance to the goal at the maximum speed of the cars
+ */
+class EuclideanHeuristic {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param goal The goal point
+   */
+  EuclideanHeuristic(const CityGraph &graph, const CityGraph::point &goal) : graph(graph), goal(goal.position) {}
+
+  double operator()(int pointId) const {
+    sf::Vector2f diff = goal - graph.getPoint(pointId).position;
+    double distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
+    return distance / CAR_MAX_SPEED_MS;
+  }
+
+private:
+  const CityGraph &graph;
+  sf::Vector2f goal;
+};
+
+/**
+ * @class ZeroHeuristic
+ * @brief No estimate of the remaining time: the search is a Dijkstra
+ */
+class ZeroHeuristic {
+public:
+  double operator()(int) const { return 0; }
+};
+
+/**
+ * @class LandmarkHeuristic
+ * @brief ALT heuristic: triangle inequality on the landmark travel times of the graph
+ *
+ * For a landmark L, the travel time from a point v to the target t is at least T(L, t) - T(L, v) and T(v, L) - T(t, L).
+ * The heuristic is the largest of these bounds over the landmarks and of the Euclidean bound. The travel times are
+ * lower bounds themselves (CityGraph::getMinTravelTime), so the heuristic stays admissible. With reverse set, it bounds
+ * the travel time from the target to the point instead, for backward searches.
+ */
+class LandmarkHeuristic {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph, with its landmarks computed
+   * @param targetId The id of the target point
+   * @param reverse If true, bound the travel time from the target to the point
+   */
+  LandmarkHeuristic(const CityGraph &graph, int targetId, bool reverse = false)
+      : graph(graph), euclidean(graph, graph.getPoint(targetId)), target(graph.getLandmarkTimes(targetId)),
+        numLandmarks(graph.getNumLandmarks()), reverse(reverse) {}
+
+  double operator()(int pointId) const {
+    double h = euclidean(pointId);
+    const double *times = graph.getLandmarkTimes(pointId);
+    for (int i = 0; i < 2 * numLandmarks; i += 2) {
+      // times[i]: from the landmark to the point, times[i + 1]: from the point to the landmark
+      const double *from = reverse ? target : times;
+      const double *to = reverse ? times : target;
+      if (std::isfinite(to[i]) && std::isfinite(from[i]))
+        h = std::max(h, to[i] - from[i]);
+      if (std::isfinite(from[i + 1]) && std::isfinite(to[i + 1]))
+        h = std::max(h, from[i + 1] - to[i + 1]);
+    }
+    return h;
+  }
+
+private:
+  const CityGraph &graph;
+  EuclideanHeuristic euclidean;
+  const double *target;
+  int numLandmarks;
+  bool reverse;
+};
+
+/**
+ * @class TableHeuristic
+ * @brief Precomputed lower bounds of the remaining time, by point id
+ *
+ * Used with a table from CityGraph::computeTravelTimes(goal, true): the exact travel time to the goal on the graph
+ * weighted by CityGraph::getMinTravelTime, the tightest bound that only depends on the point.
+ */
+class TableHeuristic {
+public:
+  /**
+   * @brief Constructor
+   * @param times The lower bounds by point id, borrowed: they must outlive the heuristic
+   */
+  TableHeuristic(const std::vector<double> &times) : times(times) {}
+
+  double operator()(int pointId) const { return times[pointId]; }
+
+private:
+  const std::vector<double> &times;
+};
+
+/**
+ * @class KinematicSuccessors
+ * @brief Speeds reachable at the end of an edge under the acceleration limits of the cars
+ *
+ * For an edge and an entry speed, the exit speeds are the entry speed itself and NUM_SPEED_DIVISIONS steps towards the
+ * fastest and the slowest reachable speeds, capped by the maximum speed of the edge.
+ *
+ * Swapping the acceleration and the deceleration gives the backward transitions: from the exit speed of an edge, the
+ * entry speeds it can be reached from. The searches use the precomputed tables of TableSuccessors, which the graph
+ * builds with this policy.
+ */
+class KinematicSuccessors {
+public:
+  /**
+   * @brief Constructor
+   * @param acceleration The acceleration used to reach faster speeds
+   * @param deceleration The deceleration used to reach slower speeds
+   */
+  KinematicSuccessors(double acceleration = CAR_ACCELERATION, double deceleration = CAR_DECELERATION)
+      : acceleration(acceleration), deceleration(deceleration) {}
+
+  /**
+   * @brief Call a visitor for every reachable exit speed of an edge
+   * @param edge The edge
+   * @param speed The entry speed
+   * @param visit The visitor, called with (exit speed, traversal duration)
+   */
+  template <typename Visit> void operator()(const CityGraph::edge &edge, double speed, Visit &&visit) {
+    const CityGraph::neighbor &neighborGraphPoint = edge.neighbor;
+    double distance = edge.distance;
+    if (distance == 0) {
+      visit(speed, 0.0);
+      return;
+    }
+
+    int numSpeeds = 0;
+    newSpeeds[numSpeeds++] = speed;
+
+    double nSpeedAcc = std::sqrt(std::pow(speed, 2) + 2 * acceleration * distance);
+    double nSpeedDec = std::sqrt(std::pow(speed, 2) - 2 * deceleration * distance);
+
+    auto push = [&](double nSpeed) {
+      int numSpeedDiv = NUM_SPEED_DIVISIONS;
+      for (int i = 1; i < numSpeedDiv + 1; i++) {
+        double s = (speed + (nSpeed - speed) * i / numSpeedDiv);
+        if (s < SPEED_RESOLUTION)
+          continue;
+        newSpeeds[numSpeeds++] = s;
+      }
+    };
+
+    if (nSpeedAcc > neighborGraphPoint.maxSpeed && speed < neighborGraphPoint.maxSpeed) {
+      push(neighborGraphPoint.maxSpeed);
+    } else if (nSpeedAcc < neighborGraphPoint.maxSpeed) {
+      push(nSpeedAcc);
+    }
+
+    if (nSpeedDec == nSpeedDec && std::isfinite(nSpeedDec)) { // check if nSpeedDec is finite and not NaN
+      if (nSpeedDec < 0 && speed > 0) {
+        push(0);
+      } else if (nSpeedDec >= 0) {
+        push(nSpeedDec);
+      }
+    }
+
+    for (int i = 0; i < numSpeeds; i++) {
+      double newSpeed = newSpeeds[i];
+      if (newSpeed > CAR_MAX_SPEED_MS || newSpeed > neighborGraphPoint.maxSpeed || newSpeed < 0)
+        continue;
+
+      if (newSpeed == speed && newSpeed == 0)
+        continue;
+
+      visit(newSpeed, 2 * distance / (speed + newSpeed));
+    }
+  }
+
+private:
+  double acceleration;
+  double deceleration;
+  std::array<double, 1 + 2 * NUM_SPEED_DIVISIONS> newSpeeds;
+};
+
+/**
+ * @class TableSuccessors
+ * @brief Speeds reachable at the end of an edge, read from the speed transition tables of the graph
+ *
+ * The speeds are snapped to their bucket (multiples of SPEED_RESOLUTION), so the successors of a state are a walk over
+ * a precomputed table (CityGraph::getSpeedTransitions) instead of the square roots of KinematicSuccessors. The
+ * duration is computed with the exact length of the edge. With reverse set, the speeds are the entry speeds from which
+ * the given exit speed is reachable, for backward searches.
+ */
+class TableSuccessors {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph, with its speed transition tables
+   * @param reverse If true, walk the reverse tables
+   */
+  TableSuccessors(const CityGraph &graph, bool reverse = false) : graph(graph), reverse(reverse) {}
+
+  /**
+   * @brief Call a visitor for every reachable speed of an edge
+   * @param edge The edge
+   * @param speed The entry speed (exit speed if reverse)
+   * @param visit The visitor, called with (speed, traversal duration)
+   */
+  template <typename Visit> void operator()(const CityGraph::edge &edge, double speed, Visit &&visit) const {
+    int bucket = (int)std::lround(speed / SPEED_RESOLUTION);
+    auto [first, last] = graph.getSpeedTransitions(edge, bucket, reverse);
+    double bucketSpeed = bucket * SPEED_RESOLUTION;
+    for (const int *it = first; it != last; it++) {
+      double newSpeed = *it * SPEED_RESOLUTION;
+      double sum = bucketSpeed + newSpeed;
+      if (sum == 0) {
+        if (edge.distance == 0)
+          visit(newSpeed, 0.0);
+        continue;
+      }
+      visit(newSpeed, 2 * edge.distance / sum);
+    }
+  }
+
+private:
+  const CityGraph &graph;
+  bool reverse;
+};
+
+/**
+ * @class CorridorSuccessors
+ * @brief The successors of TableSuccessors, limited to the edges that end in a corridor of road segments
+ *
+ * Used by the hierarchical search: the edges leaving the corridor are skipped before their speeds are generated.
+ */
+class CorridorSuccessors {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph, with its speed transition tables and regions
+   * @param inCorridor 1 for the road graph nodes of the corridor, by node id. Borrowed: it must outlive the policy
+   */
+  CorridorSuccessors(const CityGraph &graph, const std::vector<char> &inCorridor)
+      : graph(graph), table(graph), inCorridor(inCorridor) {}
+
+  template <typename Visit> void operator()(const CityGraph::edge &edge, double speed, Visit &&visit) const {
+    int region = graph.getRegion(edge.to);
+    if (region >= 0 && !inCorridor[region])
+      return;
+    table(edge, speed, visit);
+  }
+
+private:
+  const CityGraph &graph;
+  TableSuccessors table;
+  const std::vector<char> &inCorridor;
+};
+
+/**
+ * @class NoConstraint
+ * @brief Every edge traversal is allowed. The search skips the check entirely
+ */
+class NoConstraint {
+public:
+  static constexpr bool enabled = false;
+
+  bool operator()(const CityGraph::edge &, double, double, double, double) const { return true; }
+};
+
+/**
+ * @class PointGoal
+ * @brief The search ends on the first expanded state at a given graph point
+ */
+class PointGoal {
+public:
+  /**
+   * @brief Constructor
+   * @param pointId The id of the goal point
+   */
+  PointGoal(int pointId) : pointId(pointId) {}
+
+  bool operator()(const NodeTable::record &record, int) const { return record.key.point == pointId; }
+
+private:
+  int pointId;
+};
+
+/**
+ * @class PointSetGoal
+ * @brief The search ends once a state has been expanded at every point of a set
+ *
+ * The first expanded state of each point is recorded, so one search can serve several destinations. With a zero
+ * heuristic it is the cheapest state at the point, since Dijkstra expands states in order of cost.
+ */
+class PointSetGoal {
+public:
+  /**
+   * @brief Constructor
+   * @param pointIds The ids of the points, -1 for the points that are not in the graph. Duplicates are allowed
+   * @param settled Filled with the node table index of the state expanded at each point, -1 if it was not reached
+   */
+  PointSetGoal(const std::vector<int> &pointIds, std::vector<int> &settled) : settled(settled) {
+    settled.assign(pointIds.size(), -1);
+    for (int i = 0; i < (int)pointIds.size(); i++) {
+      if (pointIds[i] >= 0)
+        pending.emplace(pointIds[i], i);
+    }
+  }
+
+  bool operator()(const NodeTable::record &record, int index) {
+    auto range = pending.equal_range(record.key.point);
+    for (auto it = range.first; it != range.second; it++)
+      settled[it->second] = index;
+    pending.erase(range.first, range.second);
+    return pending.empty();
+  }
+
+private:
+  std::vector<int> &settled;
+  std::unordered_multimap<int, int> pending; // Point id to the index of the points not expanded yet
+};
+
+/**
+ * @class IterationBudget
+ * @brief The search gives up after a number of iterations
+ */
+class IterationBudget {
+public:
+  /**
+   * @brief Constructor
+   * @param maxIterations The maximum number of iterations
+   */
+  IterationBudget(int maxIterations = ASTAR_MAX_ITERATIONS) : maxIterations(maxIterations) {}
+
+  bool exhausted(int numIterations) const { return numIterations >= maxIterations; }
+
+private:
+  int maxIterations;
+};
+
+/**
+ * @class EdgeStateKey
+ * @brief States are told apart by their arrival edge: no pruning
+ */
+class EdgeStateKey {
+public:
+  NodeTable::key operator()(int point, int edgeId, int speedBucket, double) const {
+    return {point, edgeId, speedBucket};
+  }
+};
+
+/**
+ * @class PoseStateKey
+ * @brief Dominance pruning for searches without time constraints
+ *
+ * The successors of a state only depend on its point (position and heading) and its speed, not on the edge it was
+ * reached through. Of the states at the same point and speed bucket, the one reached first dominates the others, so
+ * they are merged.
+ */
+class PoseStateKey {
+public:
+  NodeTable::key operator()(int point, int, int speedBucket, double) const { return {point, -1, speedBucket}; }
+};
+
+/**
+ * @class TimedPoseStateKey
+ * @brief Dominance pruning for searches with time constraints (OCBS)
+ *
+ * Arriving later can avoid a conflict that arriving earlier can not, so only the states at the same point and speed
+ * bucket within the same TIME_RESOLUTION window are merged.
+ */
+class TimedPoseStateKey {
+public:
+  NodeTable::key operator()(int point, int, int speedBucket, double g) const {
+    return {point, (int)std::floor(g / TIME_RESOLUTION), speedBucket};
+  }
+};
+
+/**
+ * @brief Get the speed bucket of a speed, the speed part of the state keys
+ * @param speed The speed
+ * @return The multiple of SPEED_RESOLUTION nearest to the speed
+ */
+inline int getSpeedBucket(double speed) { return (int)std::round(speed / SPEED_RESOLUTION); }
+
+/**
+ * @brief Visit the edge traversals allowed from a state by its speed and the road rules
+ *
+ * The edges leaving the point are skipped if the speed is above their limit or if they go against the traffic, and the
+ * speeds reachable at their end are given by the successor policy. The time is added to the successor timing.
+ *
+ * @tparam BACKWARD Visit the edges into the point instead, for the backward side of a bidirectional search: the speed
+ * policy must then give the speeds at the start of the edges
+ * @param graph The graph
+ * @param ctx The A* context of the search
+ * @param successors The successor policy
+ * @param point The id of the point of the state
+ * @param speed The speed of the state
+ * @param visit Called as void(const CityGraph::edge &, int edgeId, double endSpeed, double duration)
+ */
+template <bool BACKWARD = false, typename Successors, typename Visit>
+void forEachTraversal(const CityGraph &graph, _aStarContext &ctx, Successors &successors, int point, double speed,
+                      Visit &&visit) {
+  StatsTimer timer(ctx.stats.successorTime);
+  int first = BACKWARD ? graph.getFirstReverseEdge(point) : graph.getFirstEdge(point);
+  int last = BACKWARD ? graph.getEndReverseEdge(point) : graph.getEndEdge(point);
+  for (int position = first; position < last; position++) {
+    int edgeId = BACKWARD ? graph.getReverseEdge(position) : position;
+    const CityGraph::edge &edge = graph.getEdge(edgeId);
+
+    if (speed > edge.neighbor.maxSpeed)
+      continue;
+
+    if (!edge.neighbor.isRightWay && ROAD_ENABLE_RIGHT_HAND_TRAFFIC)
+      continue;
+
+    successors(edge, speed, [&](double newSpeed, double duration) { visit(edge, edgeId, newSpeed, duration); });
+  }
+}
+
+/**
+ * @brief Check an edge traversal against the constraint policy, timed in the constraint timing
+ * @param ctx The A* context of the search
+ * @param constraint The constraint policy
+ * @param edge The edge
+ * @param startTime The time at the start of the edge
+ * @param startSpeed The speed at the start of the edge
+ * @param endSpeed The speed at the end of the edge
+ * @param duration The duration of the traversal
+ * @return True if the traversal is allowed, always true if the policy is disabled
+ */
+template <typename Constraint>
+bool isTraversalAllowed(_aStarContext &ctx, Constraint &constraint, const CityGraph::edge &edge, double startTime,
+                        double startSpeed, double endSpeed, double duration) {
+  if constexpr (Constraint::enabled) {
+    StatsTimer constraintTimer(ctx.stats.constraintTime);
+    return constraint(edge, startTime, startSpeed, endSpeed, duration);
+  }
+  return true;
+}
+
+/**
+ * @brief Relax a generated state: keep it in the node table unless a state of the same key was reached earlier
+ *
+ * The record gets its parent, arrival edge, speed and cost, and the generation statistics are counted. Its f-score,
+ * closed flag and place in the open list are left to the search.
+ *
+ * @param ctx The A* context of the search
+ * @param key The key of the state
+ * @param parent The index of the expanded record
+ * @param edgeId The id of the arrival edge
+ * @param speed The speed of the state
+ * @param g The cost of the state
+ * @return The index of the record in the node table, -1 if the state is pruned
+ */
+inline int relaxState(_aStarContext &ctx, const NodeTable::key &key, int parent, int edgeId, double speed, double g) {
+  ctx.stats.numGenerated++;
+
+  bool inserted;
+  int index = ctx.nodes.findOrInsert(key, &inserted);
+  NodeTable::record &record = ctx.nodes[index];
+  if (!inserted && g >= record.g) {
+    ctx.stats.numPruned++;
+    return -1;
+  }
+  if (!inserted && record.closed)
+    ctx.stats.numReopened++;
+  else if (!inserted)
+    ctx.stats.numDuplicates++;
+
+  record.parent = parent;
+  record.edge = edgeId;
+  record.speed = speed;
+  record.g = g;
+  return index;
+}
+
+/**
+ * @class KinematicSearch
+ * @brief A* over (graph point, arrival edge, speed) states, parameterized by policies
+ *
+ * The search runs in a borrowed A* context, so its node table, open set and path buffer are reused between queries.
+ * The statistics of the search are left in the context.
+ *
+ * @tparam Heuristic Callable as double(int pointId)
+ * @tparam Successors Callable as void(const CityGraph::edge &, double speed, visit(double speed, double duration))
+ * @tparam Constraint Callable as bool(const CityGraph::edge &, double startTime, double startSpeed, double endSpeed,
+ * double duration), with a static constexpr bool enabled
+ * @tparam Goal Callable as bool(const NodeTable::record &, int index), with the index of the record in the node table
+ * @tparam Budget Provides bool exhausted(int numIterations)
+ * @tparam StateKey Callable as NodeTable::key(int point, int edgeId, int speedBucket, double g)
+ */
+template <typename Heuristic, typename Successors, typename Constraint, typename Goal, typename Budget,
+          typename StateKey = EdgeStateKey>
+class KinematicSearch {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param ctx The A* context used as working memory
+   * @param heuristic The heuristic policy
+   * @param successors The successor policy
+   * @param constraint The constraint policy
+   * @param goal The goal policy
+   * @param budget The budget policy
+   * @param stateKey The state key policy
+   */
+  KinematicSearch(const CityGraph &graph, _aStarContext &ctx, Heuristic heuristic, Successors successors,
+                  Constraint constraint, Goal goal, Budget budget, StateKey stateKey = StateKey())
+      : graph(graph), ctx(ctx), heuristic(heuristic), successors(successors), constraint(constraint), goal(goal),
+        budget(budget), stateKey(stateKey) {}
+
+  /**
+   * @brief Run the search from a graph point at speed 0
+   *
+   * On success, the path of the context is filled with the states from the start to the goal, and its cost is stored.
+   *
+   * @param startId The id of the start point
+   * @return The index of the goal record in the node table, -1 if no path was found
+   */
+  int run(int startId) {
+    ctx.clear();
+    auto startTime = std::chrono::steady_clock::now();
+    int index = startId < 0 ? -1 : search(startId);
+    ctx.finishStats(startTime, index >= 0);
+    return index;
+  }
+
+private:
+  const CityGraph &graph;
+  _aStarContext &ctx;
+  Heuristic heuristic;
+  Successors successors;
+  Constraint constraint;
+  Goal goal;
+  Budget budget;
+  StateKey stateKey;
+
+  int search(int startId) {
+    auto &nodes = ctx.nodes;
+    auto &openSet = ctx.openSet;
+
+    bool inserted;
+    int startIndex = nodes.findOrInsert({startId, -1, 0}, &inserted);
+    nodes[startIndex].f = heuristic(startId);
+    openSet.push(startIndex, nodes[startIndex].f);
+
+    int numIterations = 0;
+    while (!openSet.empty() && !budget.exhausted(numIterations++)) {
+      int currentIndex = openSet.pop();
+      NodeTable::record &current = nodes[currentIndex];
+      current.closed = true;
+      ctx.stats.numExpansions++;
+
+      if (goal(current, currentIndex)) {
+        ctx.pathCost = current.g;
+        ctx.reconstructPath(graph, currentIndex);
+        return currentIndex;
+      }
+
+      const int currentPoint = current.key.point;
+      const double currentSpeed = current.speed;
+      const double currentG = current.g;
+
+      auto relax = [&](const CityGraph::edge &edge, int edgeId, double newSpeed, double duration) {
+        if (!isTraversalAllowed(ctx, constraint, edge, currentG, currentSpeed, newSpeed, duration))
+          return;
+
+        double g = currentG + duration;
+        int index = relaxState(ctx, stateKey(edge.to, edgeId, getSpeedBucket(newSpeed), g), currentIndex, edgeId,
+                               newSpeed, g);
+        if (index < 0)
+          return;
+
+        NodeTable::record &neighbor = nodes[index];
+        neighbor.f = g + heuristic(edge.to);
+        neighbor.closed = false;
+        openSet.push(index, neighbor.f);
+        ctx.stats.peakOpenSet = std::max(ctx.stats.peakOpenSet, (long long)openSet.size());
+      };
+      forEachTraversal(graph, ctx, successors, currentPoint, currentSpeed, relax);
+    }
+
+    return -1;
+  }
+};
+
+/**
+ * @class AnytimeKinematicSearch
+ * @brief Anytime repairing A* (ARA*) over the same states and policies as KinematicSearch
+ *
+ * The first solution is found with the heuristic inflated by a weight, which is fast but suboptimal. The weight is then
+ * lowered step by step and the solution improved, reusing the states of the previous iterations: the states improved
+ * after being expanded are kept aside (INCONS) and reopened at the next iteration instead of restarting from scratch.
+ * The search stops when the weight reaches 1 or when the wall-clock budget is spent, and returns the last solution with
+ * its suboptimality bound, the cost of the path divided by the smallest unweighted f-score of the states that could
+ * still improve it, capped by the weight of the last iteration that ran to completion. An iteration cut short by the
+ * budget proves nothing about its weight.
+ *
+ * The goal policy is evaluated when a state is generated, so it must not have side effects (PointGoal).
+ */
+template <typename Heuristic, typename Successors, typename Constraint, typename Goal, typename StateKey = EdgeStateKey>
+class AnytimeKinematicSearch {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param ctx The A* context used as working memory
+   * @param heuristic The heuristic policy, must be consistent
+   * @param successors The successor policy
+   * @param constraint The constraint policy
+   * @param goal The goal policy
+   * @param stateKey The state key policy
+   */
+  AnytimeKinematicSearch(const CityGraph &graph, _aStarContext &ctx, Heuristic heuristic, Successors successors,
+                         Constraint constraint, Goal goal, StateKey stateKey = StateKey())
+      : graph(graph), ctx(ctx), heuristic(heuristic), successors(successors), constraint(constraint), goal(goal),
+        stateKey(stateKey) {}
+
+  /**
+   * @brief Run the search from a graph point at speed 0
+   *
+   * On success, the path of the context is the best path found, with its cost and suboptimality bound.
+   *
+   * @param startId The id of the start point
+   * @param timeBudget The wall-clock budget in seconds
+   * @param initialWeight The weight of the heuristic for the first solution
+   * @param weightStep The decrease of the weight between two iterations
+   * @return The index of the goal record in the node table, -1 if no path was found
+   */
+  int run(int startId, double timeBudget, double initialWeight = ARA_INITIAL_WEIGHT,
+          double weightStep = ARA_WEIGHT_STEP) {
+    ctx.clear();
+    auto startTime = std::chrono::steady_clock::now();
+    int index = startId < 0 ? -1 : search(startId, timeBudget, initialWeight, weightStep);
+    ctx.finishStats(startTime, index >= 0);
+    return index;
+  }
+
+private:
+  const CityGraph &graph;
+  _aStarContext &ctx;
+  Heuristic heuristic;
+  Successors successors;
+  Constraint constraint;
+  Goal goal;
+  StateKey stateKey;
+
+  std::chrono::steady_clock::time_point deadline;
+  bool timedOut = false;
+  int goalIndex = -1;
+  std::vector<int> inconsistent;    // States improved after their expansion in the current iteration
+  std::vector<char> isInconsistent; // By record index
+
+  int search(int startId, double timeBudget, double initialWeight, double weightStep) {
+    using clock = std::chrono::steady_clock;
+    deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(timeBudget));
+    timedOut = false;
+    inconsistent.clear();
+    isInconsistent.clear();
+    goalIndex = -1;
+
+    bool inserted;
+    int startIndex = ctx.nodes.findOrInsert({startId, -1, 0}, &inserted);
+    double weight = std::max(1.0, initialWeight);
+    ctx.openSet.push(startIndex, weight * heuristic(startId));
+
+    // The weight of the last iteration that ran to completion, the only one its solution is known to be within
+    double completedWeight = std::numeric_limits<double>::infinity();
+    while (true) {
+      improvePath(weight);
+      if (goalIndex < 0)
+        return -1;
+      if (!timedOut)
+        completedWeight = weight;
+
+      // Every path cheaper than the solution goes through an open or inconsistent state
+      double minF = std::numeric_limits<double>::infinity();
+      for (int index : inconsistent)
+        minF = std::min(minF, ctx.nodes[index].g + heuristic(ctx.nodes[index].key.point));
+      for (int index = 0; index < ctx.nodes.size(); index++) {
+        if (ctx.openSet.contains(index))
+          minF = std::min(minF, ctx.nodes[index].g + heuristic(ctx.nodes[index].key.point));
+      }
+      double goalG = ctx.nodes[goalIndex].g;
+      double ratio = minF > 0 ? goalG / minF : (goalG > 0 ? std::numeric_limits<double>::infinity() : 1.0);
+      ctx.suboptimalityBound = std::max(1.0, std::min(completedWeight, ratio));
+      ctx.pathCost = goalG;
+      ctx.reconstructPath(graph, goalIndex);
+
+      if (weight <= 1 || ctx.suboptimalityBound <= 1 || timedOut)
+        return goalIndex;
+
+      // Next iteration: lower weight, reopen the inconsistent states, re-key the open set and empty the closed set
+      weight = std::max(1.0, weight - weightStep);
+      for (int index : inconsistent)
+        ctx.openSet.push(index, 0);
+      inconsistent.clear();
+      std::fill(isInconsistent.begin(), isInconsistent.end(), 0);
+      for (int index = 0; index < ctx.nodes.size(); index++) {
+        NodeTable::record &record = ctx.nodes[index];
+        record.closed = false;
+        if (ctx.openSet.contains(index))
+          ctx.openSet.push(index, record.g + weight * heuristic(record.key.point));
+      }
+    }
+  }
+
+  void improvePath(double weight) {
+    auto &nodes = ctx.nodes;
+    auto &openSet = ctx.openSet;
+
+    while (!openSet.empty() && (goalIndex < 0 || nodes[goalIndex].g > openSet.topKey())) {
+      if ((ctx.stats.numExpansions & 255) == 0 && std::chrono::steady_clock::now() >= deadline) {
+        timedOut = true;
+        return;
+      }
+
+      int currentIndex = openSet.pop();
+      NodeTable::record &current = nodes[currentIndex];
+      current.closed = true;
+      ctx.stats.numExpansions++;
+
+      const int currentPoint = current.key.point;
+      const double currentSpeed = current.speed;
+      const double currentG = current.g;
+
+      auto relax = [&](const CityGraph::edge &edge, int edgeId, double newSpeed, double duration) {
+        if (!isTraversalAllowed(ctx, constraint, edge, currentG, currentSpeed, newSpeed, duration))
+          return;
+
+        double g = currentG + duration;
+        int index = relaxState(ctx, stateKey(edge.to, edgeId, getSpeedBucket(newSpeed), g), currentIndex, edgeId,
+                               newSpeed, g);
+        if (index < 0)
+          return;
+
+        NodeTable::record &neighbor = nodes[index];
+        neighbor.f = g + heuristic(edge.to);
+        if (goal(neighbor, index) && (goalIndex < 0 || g < nodes[goalIndex].g))
+          goalIndex = index;
+
+        // A closed state stays closed until the next iteration: it is kept aside as inconsistent
+        if (!neighbor.closed) {
+          openSet.push(index, g + weight * heuristic(edge.to));
+          ctx.stats.peakOpenSet = std::max(ctx.stats.peakOpenSet, (long long)openSet.size());
+        } else {
+          if ((int)isInconsistent.size() <= index)
+            isInconsistent.resize(index + 1, 0);
+          if (!isInconsistent[index]) {
+            isInconsistent[index] = 1;
+            inconsistent.push_back(index);
+          }
+        }
+      };
+      forEachTraversal(graph, ctx, successors, currentPoint, currentSpeed, relax);
+    }
+  }
+};
+
+/**
+ * @class FocalKinematicSearch
+ * @brief Focal search (the low level of ECBS) over the same states and policies as KinematicSearch
+ *
+ * The open list is ordered by f-score, and the state expanded is the one with the fewest conflicts along its path
+ * among the open states whose f-score is within a factor (the suboptimality weight) of the smallest one. The path found
+ * costs at most the weight times the smallest f-score of the open list at the time the goal is expanded, a lower bound
+ * of the optimal cost: the context keeps the path cost and its suboptimality bound, the cost divided by that lower
+ * bound, so the caller can recover the lower bound.
+ *
+ * @tparam Heuristic Callable as double(int pointId), admissible
+ * @tparam Successors Callable as void(const CityGraph::edge &, double speed, visit(double speed, double duration))
+ * @tparam Constraint Callable as bool(const CityGraph::edge &, double startTime, double startSpeed, double endSpeed,
+ * double duration), with a static constexpr bool enabled
+ * @tparam Conflicts Callable as int(const CityGraph::edge &, double startTime, double startSpeed, double endSpeed,
+ * double duration), the number of conflicts of an edge traversal
+ * @tparam Goal Callable as bool(const NodeTable::record &, int index), with the index of the record in the node table
+ * @tparam Budget Provides bool exhausted(int numIterations)
+ * @tparam StateKey Callable as NodeTable::key(int point, int edgeId, int speedBucket, double g)
+ */
+template <typename Heuristic, typename Successors, typename Constraint, typename Conflicts, typename Goal,
+          typename Budget, typename StateKey = EdgeStateKey>
+class FocalKinematicSearch {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param ctx The A* context used as working memory
+   * @param heuristic The heuristic policy
+   * @param successors The successor policy
+   * @param constraint The constraint policy
+   * @param conflicts The conflict count policy
+   * @param goal The goal policy
+   * @param budget The budget policy
+   * @param stateKey The state key policy
+   */
+  FocalKinematicSearch(const CityGraph &graph, _aStarContext &ctx, Heuristic heuristic, Successors successors,
+                       Constraint constraint, Conflicts conflicts, Goal goal, Budget budget,
+                       StateKey stateKey = StateKey())
+      : graph(graph), ctx(ctx), heuristic(heuristic), successors(successors), constraint(constraint),
+        conflicts(conflicts), goal(goal), budget(budget), stateKey(stateKey) {}
+
+  /**
+   * @brief Run the search from a graph point at speed 0
+   *
+   * On success, the path of the context is filled with the states from the start to the goal, with its cost and
+   * suboptimality bound.
+   *
+   * @param startId The id of the start point
+   * @param weight The suboptimality weight, at least 1
+   * @return The index of the goal record in the node table, -1 if no path was found
+   */
+  int run(int startId, double weight) {
+    ctx.clear();
+    auto startTime = std::chrono::steady_clock::now();
+    int index = startId < 0 ? -1 : search(startId, std::max(1.0, weight));
+    ctx.finishStats(startTime, index >= 0);
+    return index;
+  }
+
+private:
+  const CityGraph &graph;
+  _aStarContext &ctx;
+  Heuristic heuristic;
+  Successors successors;
+  Constraint constraint;
+  Conflicts conflicts;
+  Goal goal;
+  Budget budget;
+  StateKey stateKey;
+
+  FocalQueue<int> open;
+  std::vector<int> handles;      // The handle of each record in the open list, -1 if it is not open
+  std::vector<int> numConflicts; // The conflicts along the path of each record
+
+  int search(int startId, double weight) {
+    auto &nodes = ctx.nodes;
+    open.clear(weight);
+    handles.clear();
+    numConflicts.clear();
+
+    bool inserted;
+    int startIndex = nodes.findOrInsert({startId, -1, 0}, &inserted);
+    nodes[startIndex].f = heuristic(startId);
+    handles.assign(startIndex + 1, -1);
+    numConflicts.assign(startIndex + 1, 0);
+    handles[startIndex] = open.push(startIndex, nodes[startIndex].f, nodes[startIndex].f, 0);
+
+    int numIterations = 0;
+    while (!open.empty() && !budget.exhausted(numIterations++)) {
+      double lowerBound = open.getLowerBound();
+      int currentIndex = open.pop();
+      handles[currentIndex] = -1;
+      NodeTable::record &current = nodes[currentIndex];
+      current.closed = true;
+      ctx.stats.numExpansions++;
+
+      if (goal(current, currentIndex)) {
+        ctx.pathCost = current.g;
+        ctx.suboptimalityBound = lowerBound > 0 ? std::max(1.0, current.g / lowerBound) : 1;
+        ctx.reconstructPath(graph, currentIndex);
+        return currentIndex;
+      }
+
+      const int currentPoint = current.key.point;
+      const double currentSpeed = current.speed;
+      const double currentG = current.g;
+      const int currentConflicts = numConflicts[currentIndex];
+
+      auto relax = [&](const CityGraph::edge &edge, int edgeId, double newSpeed, double duration) {
+        if (!isTraversalAllowed(ctx, constraint, edge, currentG, currentSpeed, newSpeed, duration))
+          return;
+
+        double g = currentG + duration;
+        int index = relaxState(ctx, stateKey(edge.to, edgeId, getSpeedBucket(newSpeed), g), currentIndex, edgeId,
+                               newSpeed, g);
+        if (index < 0)
+          return;
+
+        if ((int)handles.size() <= index) {
+          handles.resize(index + 1, -1);
+          numConflicts.resize(index + 1, 0);
+        }
+        if (handles[index] >= 0)
+          open.erase(handles[index]);
+
+        NodeTable::record &neighbor = nodes[index];
+        neighbor.f = g + heuristic(edge.to);
+        neighbor.closed = false;
+        numConflicts[index] = currentConflicts + conflicts(edge, currentG, currentSpeed, newSpeed, duration);
+        handles[index] = open.push(index, neighbor.f, neighbor.f, numConflicts[index]);
+        ctx.stats.peakOpenSet = std::max(ctx.stats.peakOpenSet, (long long)open.size());
+      };
+      forEachTraversal(graph, ctx, successors, currentPoint, currentSpeed, relax);
+    }
+
+    return -1;
+  }
+};
@@ -9,6 +9,7 @@
 
 #include "car.h"
 #include "cityGraph.h"
+#include "routePlanner.h"
 #include <SFML/Graphics.hpp>
 #include <spdlog/spdlog.h>
 #include <vector>
@@ -27,7 +28,7 @@ public:
    * @param cityGraph The city graph
    * @param CityMap The city map
    */
-  Manager(const CityGraph &cityGraph, const CityMap &CityMap) : graph(cityGraph), map(CityMap) {}
+  Manager(const CityGraph &cityGraph, const CityMap &CityMap) : graph(cityGraph), map(CityMap), planner(cityGraph) {}
 
   /**
    * @brief Initialize agents and set up the system
@@ -76,6 +77,7 @@ public:
 protected:
   int numCars;
   std::vector<Car> cars;
-  CityGraph graph;
-  CityMap map;
+  const CityGraph &graph; /**< \brief The city graph, borrowed: it must outlive the manager */
+  const CityMap &map;     /**< \brief The city map, borrowed: it must outlive the manager */
+  RoutePlanner planner;   /**< \brief The planner of the unconstrained routes, with its threads and route cache */
 };
@@ -4,67 +4,76 @@
  */
 #pragma once
 
+#include "aStar.h"
+#include "arena.h"
 #include "cityGraph.h"
+#include "conflictDetector.h"
+#include "focalQueue.h"
 #include "manager.h"
+#include "reservationIndex.h"
+#include "threadPool.h"
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <vector>
 
-typedef struct _managerOCBSConflictSituation {
-  int car;
-  sf::Vector2f at;
-  double time;
-
-  bool operator==(const _managerOCBSConflictSituation &other) const {
-    int t = std::round(time / OCBS_CONFLICT_RANGE);
-    int oT = std::round(other.time / OCBS_CONFLICT_RANGE);
-    int x = std::round(at.x / CELL_SIZE);
-    int oX = std::round(other.at.x / CELL_SIZE);
-    int y = std::round(at.y / CELL_SIZE);
-    int oY = std::round(other.at.y / CELL_SIZE);
-    return car == other.car && t == oT && x == oX && y == oY;
-  }
-} _managerOCBSConflictSituation;
-
-typedef struct _managerOCBSConflict {
-  int car;
-  int withCar;
-  double time;
-  sf::Vector2f position;
+/**
+ * @struct _managerOCBSConstraint
+ * @brief A constraint of the OCBS low level, linked to the previous constraint of its constraint tree branch
+ *
+ * The constraints are stored in an arena and never modified: a child node adds its constraints in front of the chain of
+ * its parent, so the branches share their common prefix and a constraint never leaks into another branch.
+ */
+typedef struct _managerOCBSConstraint {
+  int car;               /**< \brief The constrained car */
+  double time;           /**< \brief The time of the conflict */
+  sf::Vector2f position; /**< \brief The position the car must keep away from around that time */
+  int parent;            /**< \brief The previous constraint of the branch in the arena, -1 for none */
+} _managerOCBSConstraint;
 
-  bool operator==(const _managerOCBSConflict &other) const {
-    return car == other.car && withCar == other.withCar && time == other.time;
-  }
-} _managerOCBSConflict;
-
-namespace std {
-template <> struct hash<_managerOCBSConflictSituation> {
-  std::size_t operator()(const _managerOCBSConflictSituation &point) const {
-    int t = std::round(point.time / OCBS_CONFLICT_RANGE);
-    int x = std::round(point.at.x / CAR_LENGTH);
-    int y = std::round(point.at.y / CAR_LENGTH);
-    return std::hash<int>()(point.car) ^ std::hash<int>()(t) ^ std::hash<int>()(x) ^ std::hash<int>()(y);
-  }
+/**
+ * @brief Why the OCBS high level stopped
+ */
+enum class _managerOCBSTermination {
+  Solved,       /**< \brief A conflict-free solution was found */
+  NoSolution,   /**< \brief The constraint tree was exhausted */
+  TimeBudget,   /**< \brief CBS_MAX_SUB_TIME was reached */
+  NodeBudget,   /**< \brief CBS_MAX_NODES constraint tree nodes were expanded */
+  MemoryBudget, /**< \brief The open set reached CBS_MAX_OPENSET_SIZE */
 };
-template <> struct hash<_managerOCBSConflict> {
-  std::size_t operator()(const _managerOCBSConflict &point) const {
-    return std::hash<int>()(point.car) ^ std::hash<int>()(point.withCar) ^ std::hash<double>()(point.time) ^
-           std::hash<float>()(point.position.x) ^ std::hash<float>()(point.position.y);
-  }
+
+/**
+ * @brief The low-level search of OCBS
+ */
+enum class _managerOCBSLowLevel {
+  Kinematic,    /**< \brief Kinematic A* with time-window states (KinematicSearch) */
+  SafeInterval, /**< \brief Safe interval path planning, with waits at the stopped states (SafeIntervalSearch) */
 };
-} // namespace std
+
+/**
+ * @struct _managerOCBSResult
+ * @brief The outcome of an OCBS solve
+ */
+typedef struct _managerOCBSResult {
+  _managerOCBSTermination termination; /**< \brief Why the search stopped */
+  int numExpansions = 0;               /**< \brief The number of constraint tree nodes expanded */
+  int numConflicts = -1;               /**< \brief The conflicting car pairs of the solution, -1 if none was returned */
+  double cost = 0;                     /**< \brief The total cost of the returned solution */
+  double lowerBound = 0;               /**< \brief The lower bound of the solution costs when the solve stopped */
+  double suboptimalityBound = 1;       /**< \brief The cost divided by the lower bound */
+  double elapsed = 0;                  /**< \brief The wall-clock time of the solve in seconds */
+} _managerOCBSResult;
 
 typedef struct _managerOCBSNode {
-  std::vector<std::vector<sf::Vector2f>> paths; /**< \brief The paths for all agents */
-  std::vector<double> costs;                    /**< \brief The individual path costs */
-  double cost;                                  /**< \brief The total cost */
-  int depth;                                    /**< \brief The depth in the CBS tree */
-  bool hasResolved;                             /**< \brief If the node has resolved conflicts */
-  // std::unordered_multimap<_managerOCBSConflictSituation, std::unordered_set<_managerOCBSConflict>>
-  //     conflicts; /**< \brief The conflicts for all agents */
-
-  bool operator<(const _managerOCBSNode &other) const {
-    return cost > other.cost || (cost == other.cost && depth > other.depth);
-  }
+  ConflictDetector::paths paths;                     /**< \brief The paths for all agents, shared with other nodes */
+  std::vector<double> costs;                         /**< \brief The individual path costs */
+  double cost;                                       /**< \brief The total cost */
+  std::vector<double> lowerBounds;                   /**< \brief The lower bounds of the individual path costs */
+  double lowerBound;                                 /**< \brief The lower bound of the cost below the node */
+  int depth;                                         /**< \brief The depth in the CBS tree */
+  bool hasResolved;                                  /**< \brief If the node has resolved conflicts */
+  std::vector<ConflictDetector::pair> conflictPairs; /**< \brief The conflicting cars, sorted by first conflict */
+  int constraints;                                   /**< \brief The last constraint of the branch, -1 for none */
+  std::size_t memoryUsage;                           /**< \brief The bytes added to the open set memory at push */
 } _managerOCBSNode;
 
 /**
@@ -73,19 +82,38 @@ typedef struct _managerOCBSNode {
  * This class is responsible for managing the agents and their paths using the Conflict-Based Search (CBS) algorithm.
  * It inherits from the Manager class and implements the pathfinding logic specific to the CBS algorithm.
  * This class initializes paths for agents, handles user input, and plans paths using the CBS algorithm.
+ *
+ * Each conflict splits a node into two children, one per car of the conflict, each keeping its car away from the
+ * position of the other car.
+ *
+ * With a suboptimality factor w above 1, the solve is an ECBS: the high level expands, among the nodes whose cost is
+ * within w times the smallest lower bound of the open set, the one with the fewest conflicting pairs, and the low level
+ * is a focal search (FocalKinematicSearch) preferring the paths with the fewest conflicts with the other cars. With
+ * w = 1 the lower bounds are the costs, so the nodes are expanded by cost and the ties are broken by the number of
+ * conflicting pairs.
+ *
+ * The result reports the cost of the solution divided by the smallest lower bound of the open nodes and of the
+ * branches dropped because a replan ran out of iterations. The costs and bounds are those of the low level, over its
+ * discretized speeds and time windows, so the bound compares the solution with the best one in that state space.
  */
 class ManagerOCBS : public Manager {
 public:
-  using ConflictSituation = _managerOCBSConflictSituation;
-  using Conflict = _managerOCBSConflict;
+  using Constraint = _managerOCBSConstraint;
   using Node = _managerOCBSNode;
+  using Termination = _managerOCBSTermination;
+  using Result = _managerOCBSResult;
+  using LowLevel = _managerOCBSLowLevel;
 
   /**
    * @brief Constructor
    * @param cityGraph The city graph
    * @param CityMap The city map
    */
-  ManagerOCBS(const CityGraph &cityGraph, const CityMap &cityMap) : Manager(cityGraph, cityMap) {}
+  ManagerOCBS(const CityGraph &cityGraph, const CityMap &cityMap)
+      : Manager(cityGraph, cityMap), lowLevel(OCBS_SAFE_INTERVALS ? LowLevel::SafeInterval : LowLevel::Kinematic),
+        suboptimality(ECBS_SUBOPTIMALITY), conflictPool(CONFLICT_NUM_THREADS) {
+    conflictDetector.setThreadPool(&conflictPool);
+  }
 
   /**
    * @brief Initialize agents and set up the system
@@ -106,15 +134,60 @@ public:
    */
   void planPaths() override;
 
+  /**
+   * @brief Get the outcome of the last solve
+   * @return The termination reason and the statistics of the last call to planPaths
+   */
+  const Result &getLastResult() const { return lastResult; }
+
+  /**
+   * @brief Choose the low-level search of the next solves
+   * @param lowLevel The low-level search
+   */
+  void setLowLevel(LowLevel lowLevel) { this->lowLevel = lowLevel; }
+
+  /**
+   * @brief Get the low-level search
+   * @return The low-level search of the solves
+   */
+  LowLevel getLowLevel() const { return lowLevel; }
+
+  /**
+   * @brief Set the suboptimality factor of the next solves
+   * @param suboptimality The factor w, 1 for an optimal solve, above 1 for an ECBS solve within w times the optimum
+   */
+  void setSuboptimality(double suboptimality) { this->suboptimality = std::max(1.0, suboptimality); }
+
+  /**
+   * @brief Get the suboptimality factor
+   * @return The factor of the solves
+   */
+  double getSuboptimality() const { return suboptimality; }
+
 private:
   bool findConflict(int *car1, int *car2, int *time, Node *node);
-  bool findPaths();
-  void pathfinding(Node *node, int carIndex);
+  int countConflicts(const Node &node);
+  const std::vector<double> &getGoalTimes(int carIndex, int endId);
+  Result findPaths();
+  bool pathfinding(Node *node, int carIndex);
+  int addConstraint(int parent, int car, double time, const sf::Vector2f &position);
+  void buildConstraintIndex(const Node &node, int carIndex);
+  void buildPathIndex(const Node &node, int carIndex);
+  void pushNode(Node node);
 
   std::vector<_cityGraphPoint> starts;           /**< \brief The start points of the cars */
   std::vector<_cityGraphPoint> ends;             /**< \brief The end points of the cars */
-  std::vector<double> baseCosts;                 /**< \brief The base costs of the cars */
-  std::priority_queue<_managerOCBSNode> openSet; /**< \brief The open set for the CBS algorithm */
-  std::unordered_map<_managerOCBSConflictSituation, std::unordered_set<_managerOCBSConflict> *>
-      conflicts; /**< \brief The conflicts for all agents */
+  FocalQueue<_managerOCBSNode> openSet;          /**< \brief The open and focal sets of the CBS algorithm */
+  Arena<Constraint> constraints;                 /**< \brief The constraints of the solve, freed at its end */
+  ReservationIndex constraintIndex;              /**< \brief The constraints of the car being replanned */
+  ReservationIndex pathIndex;                    /**< \brief The paths of the other cars, for the ECBS low level */
+  AStar::context searchContext;      /**< \brief The low-level search buffers, reused between replans */
+  AStar::stats searchStats;          /**< \brief The statistics of the low-level searches of the current solve */
+  Result lastResult;                 /**< \brief The outcome of the last solve */
+  LowLevel lowLevel;                 /**< \brief The low-level search of the replans */
+  double suboptimality;              /**< \brief The suboptimality factor, 1 for an optimal solve */
+  ThreadPool conflictPool;           /**< \brief The threads of the conflict check, scanning slices of the horizon */
+  ConflictDetector conflictDetector; /**< \brief The conflict check of the constraint tree nodes */
+  std::vector<std::vector<double>>
+      goalTimes; /**< \brief The travel times to the goal of each car by point id, computed at its first replan */
 };
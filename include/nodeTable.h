@@ -0,0 +1,166 @@
+/**
+ * @file nodeTable.h
+ * @brief Open-addressing table of search states
+ *
+ * This file contains the NodeTable class. It replaces the cameFrom, gScore and fScore hash maps of the A* searches by a
+ * single table of compact records, so each relaxation does one lookup.
+ */
+#pragma once
+
+#include "arena.h"
+#include "config.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct _nodeTableKey
+ * @brief The identity of a search state
+ *
+ * A state is a graph point with a quantized speed, and a tag telling apart the states the search keeps separate at
+ * the same point and speed: the arrival edge, a time bucket, or nothing (-1), depending on the state key policy of the
+ * search (kinematicSearch.h). The start state has the tag -1.
+ */
+typedef struct _nodeTableKey {
+  int point;       /**< \brief The id of the graph point */
+  int tag;         /**< \brief The arrival edge, the time bucket or -1, see the state key policies */
+  int speedBucket; /**< \brief The speed, quantized with SPEED_RESOLUTION */
+
+  bool operator==(const _nodeTableKey &other) const {
+    return point == other.point && tag == other.tag && speedBucket == other.speedBucket;
+  }
+} _nodeTableKey;
+
+/**
+ * @struct _nodeTableRecord
+ * @brief A search state and its bookkeeping
+ */
+typedef struct _nodeTableRecord {
+  _nodeTableKey key;   /**< \brief The identity of the state */
+  int parent = -1;     /**< \brief The index of the parent record, -1 for the start */
+  int edge = -1;       /**< \brief The id of the edge used to reach the state, -1 for the start */
+  double speed = 0;    /**< \brief The exact speed of the car at the point */
+  double g = 0;        /**< \brief The cost from the start */
+  double f = 0;        /**< \brief The estimated total cost through the state */
+  double wait = 0;     /**< \brief The time waited at the parent point before taking the edge */
+  bool closed = false; /**< \brief If the state has been expanded */
+} _nodeTableRecord;
+
+/**
+ * @class NodeTable
+ * @brief An open-addressing hash table of search states
+ *
+ * The records are allocated in a pooled arena and addressed by index, parents included, so path reconstruction only
+ * walks parent indices. The slot array uses linear probing and is kept at most half full.
+ */
+class NodeTable {
+public:
+  using key = _nodeTableKey;
+  using record = _nodeTableRecord;
+
+  /**
+   * @brief Remove every record, keeping the allocated memory
+   */
+  void clear() {
+    records.reset();
+    std::fill(slots.begin(), slots.end(), -1);
+    numProbes = 0;
+  }
+
+  /**
+   * @brief Find a record
+   * @param k The key of the record
+   * @return The index of the record, -1 if it is not in the table
+   */
+  int find(const key &k) {
+    if (slots.empty())
+      return -1;
+
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t slot = hash(k) & mask;; slot = (slot + 1) & mask) {
+      numProbes++;
+      int index = slots[slot];
+      if (index < 0)
+        return -1;
+      if (records[index].key == k)
+        return index;
+    }
+  }
+
+  /**
+   * @brief Find a record, creating it if it is not in the table
+   * @param k The key of the record
+   * @param inserted Set to true if the record was created
+   * @return The index of the record
+   */
+  int findOrInsert(const key &k, bool *inserted) {
+    if (2 * (std::size_t)(records.size() + 1) > slots.size())
+      grow();
+
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t slot = hash(k) & mask;; slot = (slot + 1) & mask) {
+      numProbes++;
+      int index = slots[slot];
+      if (index < 0) {
+        index = records.allocate();
+        records[index].key = k;
+        slots[slot] = index;
+        *inserted = true;
+        return index;
+      }
+      if (records[index].key == k) {
+        *inserted = false;
+        return index;
+      }
+    }
+  }
+
+  /**
+   * @brief Get the number of records
+   * @return The number of records
+   */
+  int size() const { return records.size(); }
+
+  /**
+   * @brief Get the number of slots visited by the lookups since the last clear
+   * @return The number of probes
+   */
+  long long getNumProbes() const { return numProbes; }
+
+  /**
+   * @brief Get the memory held by the table
+   * @return The number of bytes of the slots and the records
+   */
+  std::size_t getMemoryUsage() const { return slots.capacity() * sizeof(int) + records.getMemoryUsage(); }
+
+  record &operator[](int index) { return records[index]; }
+  const record &operator[](int index) const { return records[index]; }
+
+private:
+  std::vector<int> slots; // Record index of each slot, -1 if empty. The size is a power of two
+  Arena<record> records;
+  long long numProbes = 0;
+
+  static std::size_t hash(const key &k) {
+    std::uint64_t h = (std::uint64_t)(std::uint32_t)k.point;
+    h = h * 0x9E3779B97F4A7C15ULL ^ (std::uint32_t)k.tag;
+    h = h * 0x9E3779B97F4A7C15ULL ^ (std::uint32_t)k.speedBucket;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return (std::size_t)h;
+  }
+
+  void grow() {
+    std::size_t newSize = slots.empty() ? NODE_TABLE_INITIAL_SLOTS : slots.size() * 2;
+    slots.assign(newSize, -1);
+
+    std::size_t mask = newSize - 1;
+    for (int index = 0; index < records.size(); index++) {
+      std::size_t slot = hash(records[index].key) & mask;
+      while (slots[slot] >= 0)
+        slot = (slot + 1) & mask;
+      slots[slot] = index;
+    }
+  }
+};
@@ -0,0 +1,143 @@
+/**
+ * @file reservationIndex.h
+ * @brief Spatio-temporal index of the constraints of a car
+ *
+ * This file contains the declaration of the ReservationIndex class, the constraint lookup of the OCBS low level. A
+ * constraint forbids a car to come within the collision range of a position during a time bucket of
+ * OCBS_CONFLICT_RANGE seconds.
+ */
+#pragma once
+
+#include "config.h"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @struct _reservationIndexEntry
+ * @brief A constraint, keyed by its time bucket and its cell
+ */
+typedef struct _reservationIndexEntry {
+  int bucket;            /**< \brief The time bucket of the constraint */
+  int x;                 /**< \brief The column of the cell of the position */
+  int y;                 /**< \brief The row of the cell of the position */
+  sf::Vector2f position; /**< \brief The position to keep away from */
+
+  bool operator<(const _reservationIndexEntry &other) const {
+    if (bucket != other.bucket)
+      return bucket < other.bucket;
+    return x < other.x || (x == other.x && y < other.y);
+  }
+} _reservationIndexEntry;
+
+/**
+ * @class ReservationIndex
+ * @brief The constraints of a car sorted by time bucket, then by grid cell
+ *
+ * The buckets are dense offsets into the sorted constraints, so finding the constraints of a bucket or of a time span
+ * is constant time. The cells are as large as the collision range, so a position can only be blocked by the
+ * constraints of its cell and of the 8 neighboring cells of the same bucket: a crowded bucket is searched by cell, a
+ * small one (RESERVATION_SCAN_ENTRIES) is simply scanned. The low level first asks whether the time span of an edge
+ * overlaps any constraint (overlaps), which skips the sampling of most edges.
+ *
+ * The index is filled with add, then sorted once with build before the queries.
+ */
+class ReservationIndex {
+public:
+  using entry = _reservationIndexEntry;
+
+  /**
+   * @brief Constructor
+   * @param range The distance under which a position is blocked by a constraint
+   */
+  ReservationIndex(float range = CAR_LENGTH * COLLISION_SAFETY_FACTOR) : range(range) {}
+
+  /**
+   * @brief Remove every constraint, keeping the memory
+   */
+  void clear();
+
+  /**
+   * @brief Free the memory of the index
+   */
+  void release();
+
+  /**
+   * @brief Add a constraint, visible to the queries after the next build
+   * @param time The time of the constraint in seconds
+   * @param position The position to keep away from
+   */
+  void add(double time, const sf::Vector2f &position);
+
+  /**
+   * @brief Sort the constraints for the queries
+   */
+  void build();
+
+  /**
+   * @brief Check if the index holds no constraint
+   * @return True if there is no constraint
+   */
+  bool empty() const { return entries.empty(); }
+
+  /**
+   * @brief Get the time bucket of a time
+   * @param time The time in seconds
+   * @return The bucket
+   */
+  static int getBucket(double time) { return std::round(time / OCBS_CONFLICT_RANGE); }
+
+  /**
+   * @brief Check if any constraint has a time bucket between the buckets of two times
+   * @param startTime The start of the time span in seconds
+   * @param endTime The end of the time span in seconds
+   * @return True if a constraint may apply during the span
+   */
+  bool overlaps(double startTime, double endTime) const;
+
+  /**
+   * @brief Check if a time bucket holds any constraint
+   * @param bucket The bucket
+   * @return True if the bucket holds a constraint
+   */
+  bool hasBucket(int bucket) const { return getBucketEnd(bucket) > getBucketBegin(bucket); }
+
+  /**
+   * @brief Check if a position is within the collision range of a constraint of a time bucket
+   * @param bucket The bucket
+   * @param position The position
+   * @return True if the position is blocked
+   */
+  bool isBlocked(int bucket, const sf::Vector2f &position) const;
+
+  /**
+   * @brief Get the first time bucket of the constraints
+   * @return The bucket, meaningless if the index is empty
+   */
+  int getFirstBucket() const { return firstBucket; }
+
+  /**
+   * @brief Get the bucket after the last time bucket of the constraints
+   * @return The bucket, the first bucket if the index is empty
+   */
+  int getEndBucket() const { return bucketOffsets.empty() ? firstBucket : firstBucket + (int)bucketOffsets.size() - 1; }
+
+private:
+  float range;
+  std::vector<entry> entries;      // Sorted by bucket, then cell, after build
+  std::vector<int> bucketOffsets; // First entry of each bucket from firstBucket, one more entry than buckets
+  int firstBucket = 0;
+
+  // First entry of the first bucket not before a bucket
+  int getBucketBegin(int bucket) const {
+    int i = std::clamp(bucket - firstBucket, 0, (int)bucketOffsets.size() - 1);
+    return bucketOffsets.empty() ? 0 : bucketOffsets[i];
+  }
+  // First entry of the first bucket after a bucket
+  int getBucketEnd(int bucket) const {
+    int i = std::clamp(bucket - firstBucket + 1, 0, (int)bucketOffsets.size() - 1);
+    return bucketOffsets.empty() ? 0 : bucketOffsets[i];
+  }
+  void getCell(const sf::Vector2f &position, int *x, int *y) const;
+};
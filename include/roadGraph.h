@@ -0,0 +1,98 @@
+/**
+ * @file roadGraph.h
+ * @brief Road-level abstraction of the city graph
+ *
+ * This file contains the declaration of the RoadGraph class. It is the coarse level of the hierarchical search
+ * (AStar::findPathHierarchical): one node per road segment of the city map, linked along the roads and across the
+ * intersections. A route on this graph selects the corridor of road segments the kinematic search is limited to.
+ */
+#pragma once
+
+#include "cityMap.h"
+#include "config.h"
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+/**
+ * @struct _roadGraphNode
+ * @brief A road segment of the city map
+ */
+typedef struct _roadGraphNode {
+  int road;            /**< \brief The index of the road in the city map */
+  int segment;         /**< \brief The index of the segment in the road */
+  sf::Vector2f center; /**< \brief The middle of the segment */
+} _roadGraphNode;
+
+/**
+ * @struct _roadGraphEdge
+ * @brief A link between two road segments, in one direction
+ */
+typedef struct _roadGraphEdge {
+  int to;          /**< \brief The id of the target node */
+  double distance; /**< \brief The distance between the middles of the segments */
+} _roadGraphEdge;
+
+/**
+ * @class RoadGraph
+ * @brief The road segments of a city map and their connections
+ *
+ * The links are undirected: the direction of traffic and the kinematic limits are left to the fine graph, the coarse
+ * graph only tells which road segments a route goes through.
+ */
+class RoadGraph {
+public:
+  using node = _roadGraphNode;
+  using edge = _roadGraphEdge;
+
+  /**
+   * @brief Build the graph of the road segments of a city map
+   * @param cityMap The city map
+   */
+  void build(const CityMap &cityMap);
+
+  /**
+   * @brief Get the id of the node of a road segment
+   * @param road The index of the road in the city map
+   * @param segment The index of the segment in the road
+   * @return The id of the node, -1 if there is no such segment
+   */
+  int getNodeId(int road, int segment) const {
+    if (road < 0 || road + 1 >= (int)nodeOffsets.size() || segment < 0 ||
+        nodeOffsets[road] + segment >= nodeOffsets[road + 1])
+      return -1;
+    return nodeOffsets[road] + segment;
+  }
+
+  /**
+   * @brief Get the number of nodes
+   * @return The number of nodes
+   */
+  int getNumNodes() const { return nodes.size(); }
+
+  /**
+   * @brief Get a node
+   * @param id The id of the node
+   * @return The node
+   */
+  const node &getNode(int id) const { return nodes[id]; }
+
+  /**
+   * @brief Find the corridor of road segments between two nodes
+   *
+   * The shortest route between the nodes is found with A* on the distances between the segments, then widened by a
+   * number of links on each side, so the kinematic search has room to change lanes and slow down around the turns.
+   *
+   * @param startId The id of the start node
+   * @param endId The id of the end node
+   * @param width The number of links the route is widened by
+   * @param inCorridor Set to 1 for the nodes of the corridor and 0 for the others, by node id
+   * @return True if the nodes are connected
+   */
+  bool findCorridor(int startId, int endId, int width, std::vector<char> *inCorridor) const;
+
+private:
+  std::vector<node> nodes;
+  std::vector<int> nodeOffsets; // Id of the first node of each road, one more entry than roads
+  std::vector<edge> edges;      // Links grouped by source node
+  std::vector<int> edgeOffsets; // One more entry than nodes
+};
@@ -0,0 +1,133 @@
+/**
+ * @file routeCache.h
+ * @brief Cache of unconstrained single-agent routes
+ *
+ * This file contains the declaration of the RouteCache class. Cars often repeat the same trips, so the path found for
+ * a start/end pair is kept and returned again instead of running the search from scratch.
+ */
+#pragma once
+
+#include "aStar.h"
+#include "cityGraph.h"
+#include "config.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @struct _routeCacheKey
+ * @brief The identity of a cached route
+ *
+ * The points compare on their quantized position and angle (CELL_SIZE, ANGLE_RESOLUTION), like everywhere else in the
+ * graph.
+ */
+typedef struct _routeCacheKey {
+  _cityGraphPoint start; /**< \brief The start point */
+  _cityGraphPoint end;   /**< \brief The end point */
+  unsigned int version;  /**< \brief The version of the graph the route was found on */
+
+  bool operator==(const _routeCacheKey &other) const {
+    return start == other.start && end == other.end && version == other.version;
+  }
+} _routeCacheKey;
+
+namespace std {
+template <> struct hash<_routeCacheKey> {
+  std::size_t operator()(const _routeCacheKey &key) const {
+    std::size_t h = std::hash<_cityGraphPoint>()(key.start);
+    h = h * 31 + std::hash<_cityGraphPoint>()(key.end);
+    return h * 31 + std::hash<unsigned int>()(key.version);
+  }
+};
+} // namespace std
+
+/**
+ * @struct _routeCacheEntry
+ * @brief A cached route
+ */
+typedef struct _routeCacheEntry {
+  _routeCacheKey key;           /**< \brief The identity of the route */
+  std::vector<_aStarNode> path; /**< \brief The path, empty if the search proved that there is none */
+  double cost;                  /**< \brief The travel time of the path */
+} _routeCacheEntry;
+
+/**
+ * @class RouteCache
+ * @brief A thread-safe LRU cache of unconstrained routes
+ *
+ * Routes are keyed by their start and end points and by the version of the graph (CityGraph::getVersion). When the
+ * graph changes, its version changes, the cache is emptied at the next access and the stale routes are never returned.
+ * The least recently used route is evicted when the cache is full.
+ */
+class RouteCache {
+public:
+  using key = _routeCacheKey;
+  using entry = _routeCacheEntry;
+
+  /**
+   * @brief Constructor
+   * @param capacity The maximum number of routes
+   */
+  RouteCache(std::size_t capacity = ROUTE_CACHE_CAPACITY) : capacity(capacity) {}
+
+  /**
+   * @brief Look a route up, marking it as the most recently used
+   * @param graph The graph of the query
+   * @param start The start point
+   * @param end The end point
+   * @param path Set to the cached path on a hit
+   * @param cost Set to the cached travel time on a hit
+   * @return True on a hit
+   */
+  bool find(const CityGraph &graph, const CityGraph::point &start, const CityGraph::point &end,
+            std::vector<_aStarNode> *path, double *cost);
+
+  /**
+   * @brief Store a route, evicting the least recently used one if the cache is full
+   *
+   * Only certain results are stored: a search stopped by its budget must not be cached as a missing route.
+   *
+   * @param graph The graph the route was found on
+   * @param start The start point
+   * @param end The end point
+   * @param path The path
+   * @param cost The travel time of the path
+   */
+  void insert(const CityGraph &graph, const CityGraph::point &start, const CityGraph::point &end,
+              const std::vector<_aStarNode> &path, double cost);
+
+  /**
+   * @brief Remove every route
+   */
+  void clear();
+
+  /**
+   * @brief Get the number of cached routes
+   * @return The number of routes
+   */
+  std::size_t size();
+
+  /**
+   * @brief Get the number of lookups that found a route
+   * @return The number of hits
+   */
+  long long getNumHits();
+
+  /**
+   * @brief Get the number of lookups that did not find a route
+   * @return The number of misses
+   */
+  long long getNumMisses();
+
+private:
+  std::size_t capacity;
+  std::mutex mutex;
+  std::list<entry> entries; // Most recently used first
+  std::unordered_map<key, std::list<entry>::iterator> index;
+  unsigned int version = 0; // Version of the graph of the cached routes
+  long long numHits = 0;
+  long long numMisses = 0;
+
+  void checkVersion(const CityGraph &graph);
+};
@@ -0,0 +1,108 @@
+/**
+ * @file routePlanner.h
+ * @brief Batch route planning
+ *
+ * This file contains the declaration of the RoutePlanner class. It plans the independent start/end routes of many
+ * agents at once on a thread pool, each thread reusing its own A* search buffers.
+ */
+#pragma once
+
+#include "aStar.h"
+#include "cityGraph.h"
+#include "config.h"
+#include "routeCache.h"
+#include "threadPool.h"
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct _routePlannerRoute
+ * @brief A planned route
+ */
+typedef struct _routePlannerRoute {
+  _cityGraphPoint start;        /**< \brief The start point */
+  _cityGraphPoint end;          /**< \brief The end point */
+  std::vector<_aStarNode> path; /**< \brief The path from the start to the end, empty if none was found */
+} _routePlannerRoute;
+
+/**
+ * @class RoutePlanner
+ * @brief Plans batches of independent routes on a thread pool
+ *
+ * The results are returned in the order of the queries, whatever the thread that computed them. Random routes draw
+ * their points from a generator seeded by the batch seed and the index of the route, so a route only depends on the
+ * seed, the graph and its index, not on the number of threads or the scheduling.
+ *
+ * The threads share a route cache, so repeated start/end pairs are only searched once while the graph is unchanged.
+ */
+class RoutePlanner {
+public:
+  using route = _routePlannerRoute;
+  using query = std::pair<CityGraph::point, CityGraph::point>;
+
+  /**
+   * @brief Constructor
+   * @param cityGraph The city graph, borrowed: it must outlive the planner
+   * @param numThreads The number of threads, 0 for the number of hardware threads
+   */
+  RoutePlanner(const CityGraph &cityGraph, int numThreads = PLANNER_NUM_THREADS);
+
+  /**
+   * @brief Find the paths of a batch of start/end queries
+   *
+   * The queries with the same start point are grouped and answered by one one-to-many search (AStar::findPaths), so
+   * planning many cars from one depot costs about one search.
+   *
+   * @param queries The queries
+   * @return The routes, in the order of the queries
+   */
+  std::vector<route> planRoutes(const std::vector<query> &queries);
+
+  /**
+   * @brief Choose and plan a batch of random routes
+   * @param numRoutes The number of routes
+   * @param seed The seed of the batch
+   * @return The routes, by index
+   */
+  std::vector<route> planRandomRoutes(int numRoutes, unsigned int seed);
+
+  /**
+   * @brief Choose random start and end points at least half the map apart until a path of 3 nodes or more is found
+   * @param graph The graph
+   * @param aStar The search used for the queries
+   * @param gen The random generator
+   * @return The route
+   */
+  static route planRandomRoute(const CityGraph &graph, AStar &aStar, std::mt19937 &gen);
+
+  /**
+   * @brief Get the number of threads
+   * @return The number of threads
+   */
+  int getNumThreads() const { return pool.getNumThreads(); }
+
+  /**
+   * @brief Get the route cache shared by the threads
+   * @return The cache
+   */
+  RouteCache &getCache() { return cache; }
+
+  /**
+   * @brief Get the statistics of the searches of every thread since the construction or the last resetStats
+   * @return The statistics added up
+   */
+  AStar::stats getStats() const;
+
+  /**
+   * @brief Reset the statistics of the searches
+   */
+  void resetStats();
+
+private:
+  const CityGraph &graph;
+  RouteCache cache;
+  ThreadPool pool;
+  std::vector<std::unique_ptr<AStar>> searches; // One search per thread
+};
@@ -0,0 +1,289 @@
+/**
+ * @file safeIntervalSearch.h
+ * @brief Safe interval path planning (SIPP) for the OCBS low level
+ *
+ * This file contains the reservation policies of the OCBS low level, the safe intervals of the graph points and the
+ * SafeIntervalSearch class template. A stopped car can wait at a graph point as long as no constraint blocks
+ * it there, so the stopped states are merged by safe interval instead of by time window: the earliest arrival in a
+ * safe interval dominates the later ones, since the car can wait until their time.
+ */
+#pragma once
+
+#include "aStar.h"
+#include "cityGraph.h"
+#include "config.h"
+#include "dubins.h"
+#include "kinematicSearch.h"
+#include "reservationIndex.h"
+#include "searchStats.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class ReservationConstraint
+ * @brief Constraint policy of the OCBS low level: an edge traversal must avoid the constraints of the car
+ *
+ * The traversal is sampled every SIM_STEP_TIME. An edge whose time span overlaps no constraint is accepted without
+ * sampling, and only the samples of a time bucket with constraints are interpolated and looked up in the index.
+ */
+class ReservationConstraint {
+public:
+  static constexpr bool enabled = true;
+
+  /**
+   * @brief Constructor
+   * @param index The constraints of the car, borrowed: they must outlive the policy
+   */
+  ReservationConstraint(const ReservationIndex &index) : index(index) {}
+
+  bool operator()(const CityGraph::edge &edge, double t, double startSpeed, double endSpeed, double duration) const {
+    if (!index.overlaps(t, t + duration))
+      return true;
+
+    DubinsInterpolator *interpolator = edge.interpolator;
+    for (double tt = 0; tt < duration; tt = tt + SIM_STEP_TIME) {
+      int bucket = ReservationIndex::getBucket(t + tt);
+      if (!index.hasBucket(bucket))
+        continue;
+      if (index.isBlocked(bucket, interpolator->get(tt, startSpeed, endSpeed).position))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  const ReservationIndex &index;
+};
+
+/**
+ * @class ReservationConflicts
+ * @brief Conflict count policy of the ECBS low level: an edge traversal conflicts if it comes within the collision
+ * range of the other cars
+ *
+ * The positions of the other cars are reservations of an index, checked like the constraints of ReservationConstraint.
+ */
+class ReservationConflicts {
+public:
+  /**
+   * @brief Constructor
+   * @param index The positions of the other cars, borrowed: they must outlive the policy
+   */
+  ReservationConflicts(const ReservationIndex &index) : constraint(index) {}
+
+  int operator()(const CityGraph::edge &edge, double t, double startSpeed, double endSpeed, double duration) const {
+    return constraint(edge, t, startSpeed, endSpeed, duration) ? 0 : 1;
+  }
+
+private:
+  ReservationConstraint constraint;
+};
+
+/**
+ * @class SafeIntervals
+ * @brief The time buckets during which a car can stay stopped at the graph points
+ *
+ * The safe intervals of a point are the runs of time buckets between the buckets in which a constraint blocks the
+ * point. They are computed at the first query of the point and kept for the search.
+ */
+class SafeIntervals {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param index The constraints of the car, borrowed: they must outlive the intervals and stay unchanged
+   */
+  SafeIntervals(const CityGraph &graph, const ReservationIndex &index) : graph(graph), index(index) {}
+
+  /**
+   * @brief Find the safe interval of a point containing a time bucket
+   * @param pointId The id of the point
+   * @param bucket The time bucket
+   * @param endBucket Set to the first blocked bucket after the interval, INT_MAX if the point stays safe
+   * @return The index of the interval among the safe intervals of the point, -1 if the bucket is blocked
+   */
+  int find(int pointId, int bucket, int *endBucket) {
+    const std::vector<int> &blocked = getBlocked(pointId);
+    auto it = std::lower_bound(blocked.begin(), blocked.end(), bucket);
+    if (it != blocked.end() && *it == bucket)
+      return -1;
+    *endBucket = it == blocked.end() ? INT_MAX : *it;
+    return it - blocked.begin();
+  }
+
+private:
+  const CityGraph &graph;
+  const ReservationIndex &index;
+  std::unordered_map<int, std::vector<int>> blocked; // Sorted blocked buckets by point id
+
+  const std::vector<int> &getBlocked(int pointId) {
+    auto [it, inserted] = blocked.try_emplace(pointId);
+    if (!inserted)
+      return it->second;
+
+    const sf::Vector2f &position = graph.getPoint(pointId).position;
+    for (int bucket = index.getFirstBucket(); bucket < index.getEndBucket(); bucket++) {
+      if (index.hasBucket(bucket) && index.isBlocked(bucket, position))
+        it->second.push_back(bucket);
+    }
+    return it->second;
+  }
+};
+
+/**
+ * @class SafeIntervalSearch
+ * @brief A* over (graph point, speed, safe interval) states, with waits at the stopped states
+ *
+ * The states are those of KinematicSearch with TimedPoseStateKey, except the stopped ones, which are keyed by their
+ * safe interval (tag -2 - interval) and may wait before taking an edge. From a stopped state, the departures are tried
+ * every SIPP_WAIT_STEP seconds until the end of its safe interval, at most SIPP_MAX_WAIT_STEPS times:
+ * @li a moving successor is generated for the earliest allowed departure only, as later ones arrive later at the same
+ * speed
+ * @li a stopped successor is generated for the earliest departure reaching each of its safe intervals
+ *
+ * A moving car can not wait, so the moving states keep their time windows. The speed limits and the acceleration of
+ * the edges are those of the successor policy, the waits are stored in the records (NodeTable::record::wait) and in the
+ * path (AStar::node::waitTime). The statistics of the search are left in the context.
+ *
+ * @tparam Heuristic Callable as double(int pointId)
+ * @tparam Successors Callable as void(const CityGraph::edge &, double speed, visit(double speed, double duration))
+ * @tparam Constraint Callable as bool(const CityGraph::edge &, double startTime, double startSpeed, double endSpeed,
+ * double duration), with a static constexpr bool enabled
+ * @tparam Goal Callable as bool(const NodeTable::record &, int index), with the index of the record in the node table
+ * @tparam Budget Provides bool exhausted(int numIterations)
+ */
+template <typename Heuristic, typename Successors, typename Constraint, typename Goal, typename Budget>
+class SafeIntervalSearch {
+public:
+  /**
+   * @brief Constructor
+   * @param graph The graph
+   * @param ctx The A* context used as working memory
+   * @param intervals The safe intervals of the car, from the same constraints as the constraint policy
+   * @param heuristic The heuristic policy
+   * @param successors The successor policy
+   * @param constraint The constraint policy
+   * @param goal The goal policy
+   * @param budget The budget policy
+   */
+  SafeIntervalSearch(const CityGraph &graph, _aStarContext &ctx, SafeIntervals &intervals, Heuristic heuristic,
+                     Successors successors, Constraint constraint, Goal goal, Budget budget)
+      : graph(graph), ctx(ctx), intervals(intervals), heuristic(heuristic), successors(successors),
+        constraint(constraint), goal(goal), budget(budget) {}
+
+  /**
+   * @brief Run the search from a graph point at speed 0 at time 0
+   *
+   * On success, the path of the context is filled with the states from the start to the goal, and its cost is stored.
+   *
+   * @param startId The id of the start point
+   * @return The index of the goal record in the node table, -1 if no path was found
+   */
+  int run(int startId) {
+    ctx.clear();
+    auto startTime = std::chrono::steady_clock::now();
+    int index = startId < 0 ? -1 : search(startId);
+    ctx.finishStats(startTime, index >= 0);
+    return index;
+  }
+
+private:
+  const CityGraph &graph;
+  _aStarContext &ctx;
+  SafeIntervals &intervals;
+  Heuristic heuristic;
+  Successors successors;
+  Constraint constraint;
+  Goal goal;
+  Budget budget;
+
+  static NodeTable::key getKey(int point, int speedBucket, double g, int interval) {
+    if (speedBucket == 0)
+      return {point, -2 - interval, 0};
+    return {point, (int)std::floor(g / TIME_RESOLUTION), speedBucket};
+  }
+
+  int search(int startId) {
+    auto &nodes = ctx.nodes;
+    auto &openSet = ctx.openSet;
+
+    int startEnd;
+    int startInterval = intervals.find(startId, ReservationIndex::getBucket(0), &startEnd);
+    if (startInterval < 0)
+      return -1;
+
+    bool inserted;
+    int startIndex = nodes.findOrInsert(getKey(startId, 0, 0, startInterval), &inserted);
+    nodes[startIndex].f = heuristic(startId);
+    openSet.push(startIndex, nodes[startIndex].f);
+
+    int numIterations = 0;
+    while (!openSet.empty() && !budget.exhausted(numIterations++)) {
+      int currentIndex = openSet.pop();
+      NodeTable::record &current = nodes[currentIndex];
+      current.closed = true;
+      ctx.stats.numExpansions++;
+
+      if (goal(current, currentIndex)) {
+        ctx.pathCost = current.g;
+        ctx.reconstructPath(graph, currentIndex);
+        return currentIndex;
+      }
+
+      const int currentPoint = current.key.point;
+      const double currentSpeed = current.speed;
+      const double currentG = current.g;
+
+      // A stopped state can wait until the end of its safe interval
+      int waitEnd = INT_MIN;
+      int numWaits = 0;
+      if (current.key.speedBucket == 0 &&
+          intervals.find(currentPoint, ReservationIndex::getBucket(currentG), &waitEnd) >= 0)
+        numWaits = SIPP_MAX_WAIT_STEPS;
+
+      auto relax = [&](const CityGraph::edge &edge, int edgeId, double newSpeed, double duration) {
+        int bucket = getSpeedBucket(newSpeed);
+        int lastInterval = -1;
+        for (int k = 0; k <= numWaits; k++) {
+          double departure = currentG + k * SIPP_WAIT_STEP;
+          if (k > 0 && ReservationIndex::getBucket(departure) >= waitEnd)
+            return;
+          if (!isTraversalAllowed(ctx, constraint, edge, departure, currentSpeed, newSpeed, duration))
+            continue;
+
+          double arrival = departure + duration;
+          int interval = -1;
+          int intervalEnd = INT_MAX;
+          if (bucket == 0) {
+            // The car stops at the end of the edge: the point must be safe at its arrival
+            interval = intervals.find(edge.to, ReservationIndex::getBucket(arrival), &intervalEnd);
+            if (interval < 0 || interval == lastInterval)
+              continue;
+            lastInterval = interval;
+          }
+
+          int index = relaxState(ctx, getKey(edge.to, bucket, arrival, interval), currentIndex, edgeId, newSpeed,
+                                 arrival);
+          if (index >= 0) {
+            NodeTable::record &neighbor = nodes[index];
+            neighbor.f = arrival + heuristic(edge.to);
+            neighbor.wait = departure - currentG;
+            neighbor.closed = false;
+            openSet.push(index, neighbor.f);
+            ctx.stats.peakOpenSet = std::max(ctx.stats.peakOpenSet, (long long)openSet.size());
+          }
+
+          // Waiting longer only delays a moving arrival, or reaches the same last safe interval
+          if (bucket != 0 || intervalEnd == INT_MAX)
+            return;
+        }
+      };
+      forEachTraversal(graph, ctx, successors, currentPoint, currentSpeed, relax);
+    }
+
+    return -1;
+  }
+};
@@ -0,0 +1,87 @@
+/**
+ * @file searchStats.h
+ * @brief Statistics of the path searches
+ *
+ * This file contains the SearchStats struct. Every A* search (AStar and the OCBS low level) fills one, so slow planning
+ * can be traced to the heuristic (expansions), the state space (generated and duplicate states) or the node table
+ * (probes), and the time to the successors or the constraint checks.
+ */
+#pragma once
+
+#include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+/**
+ * @struct _searchStats
+ * @brief The counters and timings of one search, or of several searches once added up
+ */
+typedef struct _searchStats {
+  int numSearches = 0;         /**< \brief The number of searches added up */
+  int numFound = 0;            /**< \brief The number of searches that found a path */
+  long long numExpansions = 0; /**< \brief The number of states expanded */
+  long long numGenerated = 0;  /**< \brief The number of transitions that passed the constraint check */
+  long long numPruned = 0;     /**< \brief The generated transitions that did not improve an existing state */
+  long long numReopened = 0;   /**< \brief The closed states improved and pushed again */
+  long long numDuplicates = 0; /**< \brief The pushes of a state already in the open set (key decreases) */
+  long long peakOpenSet = 0;   /**< \brief The largest open set size, the largest of the searches once added up */
+  long long numProbes = 0;     /**< \brief The slots visited by the node table lookups */
+  double successorTime = 0;    /**< \brief The seconds spent expanding states, constraint checks excluded */
+  double constraintTime = 0;   /**< \brief The seconds spent in the constraint checks */
+  double wallTime = 0;         /**< \brief The seconds from the start to the end of the search */
+
+  /**
+   * @brief Add up the statistics of another search
+   * @param other The statistics to add
+   * @return This
+   */
+  _searchStats &operator+=(const _searchStats &other) {
+    numSearches += other.numSearches;
+    numFound += other.numFound;
+    numExpansions += other.numExpansions;
+    numGenerated += other.numGenerated;
+    numPruned += other.numPruned;
+    numReopened += other.numReopened;
+    numDuplicates += other.numDuplicates;
+    peakOpenSet = std::max(peakOpenSet, other.peakOpenSet);
+    numProbes += other.numProbes;
+    successorTime += other.successorTime;
+    constraintTime += other.constraintTime;
+    wallTime += other.wallTime;
+    return *this;
+  }
+
+  /**
+   * @brief Format the statistics as a JSON object
+   * @return The JSON object, on one line
+   */
+  std::string toJson() const;
+} _searchStats;
+
+/**
+ * @class StatsTimer
+ * @brief Adds the duration of its scope to a timing of the statistics
+ *
+ * Does nothing when SEARCH_STATS_TIMING is false, so the searches can be built without the clock reads.
+ */
+class StatsTimer {
+public:
+  /**
+   * @brief Constructor, starts the timer
+   * @param total The timing the duration is added to
+   */
+  StatsTimer(double &total) : total(total) {
+    if constexpr (SEARCH_STATS_TIMING)
+      start = std::chrono::steady_clock::now();
+  }
+
+  ~StatsTimer() {
+    if constexpr (SEARCH_STATS_TIMING)
+      total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+private:
+  double &total;
+  std::chrono::steady_clock::time_point start;
+};
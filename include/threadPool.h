@@ -0,0 +1,72 @@
+/**
+ * @file threadPool.h
+ * @brief Fixed pool of worker threads
+ *
+ * This file contains the declaration of the ThreadPool class. It runs batches of independent tasks, such as the route
+ * queries of the agents, on a fixed set of threads started once.
+ */
+#pragma once
+
+#include "config.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed pool of worker threads running batches of indexed tasks
+ *
+ * Each task receives its index in the batch and the index of the thread running it, so callers can keep one working
+ * buffer per thread instead of locking a shared one. A batch blocks the calling thread until every task is done.
+ */
+class ThreadPool {
+public:
+  /**
+   * @brief Constructor
+   * @param numThreads The number of worker threads, 0 for the number of hardware threads
+   */
+  ThreadPool(int numThreads = PLANNER_NUM_THREADS);
+
+  /**
+   * @brief Destructor, waits for the worker threads to stop
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Get the number of worker threads
+   * @return The number of threads
+   */
+  int getNumThreads() const { return (int)workers.size(); }
+
+  /**
+   * @brief Run a batch of tasks and wait for all of them
+   *
+   * If a task throws, the other tasks still run and the first exception is rethrown to the caller.
+   *
+   * @param numTasks The number of tasks
+   * @param task The task, called as task(taskIndex, threadIndex)
+   */
+  void parallelFor(int numTasks, const std::function<void(int, int)> &task);
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::condition_variable done;
+
+  const std::function<void(int, int)> *task = nullptr;
+  int numTasks = 0;
+  int nextTask = 0;
+  int numBusy = 0;
+  unsigned int generation = 0; // Incremented for each batch, so a worker runs each batch once
+  bool stopping = false;
+  std::exception_ptr error;
+
+  void workerLoop(int threadIndex);
+};
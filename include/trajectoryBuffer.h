@@ -0,0 +1,117 @@
+/**
+ * @file trajectoryBuffer.h
+ * @brief Time-major structure-of-arrays storage of the sampled paths of the cars
+ *
+ * This file contains the TrajectoryBuffer class and the distance kernels of the conflict checks. The positions of all
+ * the cars at one time step are contiguous, x and y apart, so one car can be compared with many cars per instruction.
+ */
+#pragma once
+
+#include "config.h"
+#include <SFML/Graphics.hpp>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * @class TrajectoryBuffer
+ * @brief The positions of the cars, stored as x[t][car] and y[t][car]
+ *
+ * The rows are padded to a multiple of TRAJECTORY_LANES cars so the kernels can process whole rows. The cars whose path
+ * is over (arrived) and the padding hold far-away positions, spaced apart, so they never collide with anything and the
+ * kernels need no mask.
+ *
+ * The buffer can hold a window of steps only, so a scan that stops at an early conflict does not pay for copying the
+ * whole horizon.
+ */
+class TrajectoryBuffer {
+public:
+  using path = std::shared_ptr<const std::vector<sf::Vector2f>>; // Immutable, shared by the nodes that keep it
+  using paths = std::vector<path>;
+
+  /**
+   * @brief Fill the buffer from paths stored per car
+   * @param paths The positions of each car at each step
+   * @param firstStep The first step of the window
+   * @param maxSteps The maximum number of steps of the window, the rest of the horizon by default
+   */
+  void assign(const paths &paths, int firstStep = 0, int maxSteps = std::numeric_limits<int>::max());
+
+  /**
+   * @brief Get the number of cars
+   * @return The number of cars
+   */
+  int getNumCars() const { return numCars; }
+
+  /**
+   * @brief Get the number of steps, the length of the longest path
+   * @return The number of steps
+   */
+  int getNumSteps() const { return numSteps; }
+
+  /**
+   * @brief Get the first step of the window
+   * @return The step
+   */
+  int getFirstStep() const { return firstStep; }
+
+  /**
+   * @brief Get the step after the window
+   * @return The step
+   */
+  int getEndStep() const { return endStep; }
+
+  /**
+   * @brief Get the x coordinates of the cars at a step of the window
+   * @param time The step
+   * @return The row, with getNumCars() values followed by the padding
+   */
+  const float *getX(int time) const { return x.data() + (std::size_t)(time - firstStep) * stride; }
+
+  /**
+   * @brief Get the y coordinates of the cars at a step of the window
+   * @param time The step
+   * @return The row, with getNumCars() values followed by the padding
+   */
+  const float *getY(int time) const { return y.data() + (std::size_t)(time - firstStep) * stride; }
+
+  /**
+   * @brief Check if a car is still driving at a step
+   * @param car The index of the car
+   * @param time The step
+   * @return True if the path of the car has not ended
+   */
+  bool isActive(int car, int time) const { return time < lengths[car]; }
+
+private:
+  int numCars = 0;
+  int numSteps = 0;
+  int firstStep = 0;
+  int endStep = 0;
+  int stride = 0; // Cars per row, padding included
+  std::vector<int> lengths;
+  std::vector<float> x;
+  std::vector<float> y;
+};
+
+/**
+ * @brief Find the first position closer than a range to a point
+ *
+ * Squared distances are compared, without square root. The implementation is chosen at the first call: AVX2 if the CPU
+ * supports it, NEON on ARM, scalar code otherwise.
+ *
+ * @param x The x coordinates
+ * @param y The y coordinates
+ * @param count The number of positions
+ * @param px The x coordinate of the point
+ * @param py The y coordinate of the point
+ * @param range2 The squared range
+ * @return The index of the first position closer than the range, -1 if there is none
+ */
+int findFirstInRange(const float *x, const float *y, int count, float px, float py, float range2);
+
+/**
+ * @brief Get the name of the implementation of findFirstInRange used on this CPU
+ * @return "avx2", "neon" or "scalar"
+ */
+const char *getTrajectoryKernelName();
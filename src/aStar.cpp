@@ -4,151 +4,345 @@
  *
  * This file contains the implementation of the A* algorithm for finding the shortest path
  * between two points in a graph for a single agent without considering conflicts with other agents.
- * 
- * @note A similar A* implementation exists in managers/ocbs.cpp with additional conflict checking
- * for multi-agent scenarios. While there is code duplication, each serves a distinct purpose:
- * @li This implementation: Fast single-agent pathfinding
- * @li OCBS implementation: Multi-agent pathfinding with conflict resolution
+ *
+ * @note The search loop lives in kinematicSearch.h and is shared with the OCBS low level (managers/ocbs.cpp). This
+ * file instantiates it without constraint check, so conflict-free searches do not pay for it.
  */
 #include "aStar.h"
 #include "config.h"
-#include "dubins.h"
-#include "utils.h"
-
+#include "kinematicSearch.h"
+#include "routeCache.h"
+#include <limits>
 #include <spdlog/spdlog.h>
-#include <unordered_set>
 
-AStar::AStar(CityGraph::point start, CityGraph::point end, const CityGraph &cityGraph) {
+AStar::AStar(const CityGraph &cityGraph) : graph(cityGraph) {
+  this->start.speed = 0;
+  this->end.speed = 0;
+}
+
+AStar::AStar(CityGraph::point start, CityGraph::point end, const CityGraph &cityGraph) : graph(cityGraph) {
   this->start.point = start;
   this->start.speed = 0;
   this->end.point = end;
   this->end.speed = 0;
-  this->graph = cityGraph;
+}
+
+const std::vector<AStar::node> &AStar::findPath(CityGraph::point start, CityGraph::point end) {
+  this->start = node();
+  this->start.point = start;
+  this->start.speed = 0;
+  this->end = node();
+  this->end.point = end;
+  this->end.speed = 0;
+
+  process();
+  return ctx.path;
+}
+
+const std::vector<AStar::node> &AStar::findPathBidirectional(CityGraph::point start, CityGraph::point end) {
+  this->start = node();
+  this->start.point = start;
+  this->start.speed = 0;
+  this->end = node();
+  this->end.point = end;
+  this->end.speed = 0;
+
+  processBidirectional();
+  return ctx.path;
+}
+
+std::vector<std::vector<AStar::node>> AStar::findPaths(CityGraph::point start,
+                                                      const std::vector<CityGraph::point> &ends,
+                                                      std::vector<double> *costs) {
+  auto startTime = std::chrono::steady_clock::now();
+  processed = true;
+  if (backwardCtx.nodes.size() > 0)
+    backwardCtx.clear();
+
+  std::vector<int> endIds;
+  endIds.reserve(ends.size());
+  for (const auto &end : ends)
+    endIds.push_back(graph.getPointId(end));
+
+  std::vector<int> settled;
+  KinematicSearch search(graph, ctx, ZeroHeuristic(), TableSuccessors(graph), NoConstraint(),
+                         PointSetGoal(endIds, settled), IterationBudget(ONE_TO_MANY_MAX_ITERATIONS), PoseStateKey());
+  search.run(graph.getPointId(start));
+
+  std::vector<std::vector<node>> paths(ends.size());
+  if (costs)
+    costs->assign(ends.size(), 0);
+  bool found = true;
+  for (int i = 0; i < (int)ends.size(); i++) {
+    if (settled[i] < 0) {
+      found = false;
+      continue;
+    }
+    ctx.reconstructPath(graph, settled[i]);
+    paths[i] = ctx.path;
+    if (costs)
+      (*costs)[i] = ctx.nodes[settled[i]].g;
+  }
+
+  collectStats(startTime, found);
+  return paths;
+}
+
+const std::vector<AStar::node> &AStar::findPathAnytime(CityGraph::point start, CityGraph::point end,
+                                                       double timeBudget) {
+  auto startTime = std::chrono::steady_clock::now();
+  processed = true;
+  if (backwardCtx.nodes.size() > 0)
+    backwardCtx.clear();
+
+  int startId = graph.getPointId(start);
+  int endId = graph.getPointId(end);
+  if (endId < 0) {
+    ctx.clear();
+    collectStats(startTime, false);
+    return ctx.path;
+  }
+
+  auto run = [&](auto heuristic) {
+    AnytimeKinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(), PointGoal(endId),
+                                  PoseStateKey());
+    search.run(startId, timeBudget);
+  };
+  if (useLandmarks && graph.getNumLandmarks() > 0)
+    run(LandmarkHeuristic(graph, endId));
+  else
+    run(EuclideanHeuristic(graph, end));
+
+  collectStats(startTime, !ctx.path.empty());
+  return ctx.path;
+}
+
+const std::vector<AStar::node> &AStar::findPathHierarchical(CityGraph::point start, CityGraph::point end) {
+  auto startTime = std::chrono::steady_clock::now();
+  processed = true;
+  if (backwardCtx.nodes.size() > 0)
+    backwardCtx.clear();
+
+  int startId = graph.getPointId(start);
+  int endId = graph.getPointId(end);
+  if (startId < 0 || endId < 0) {
+    ctx.clear();
+    collectStats(startTime, false);
+    return ctx.path;
+  }
+
+  bool hasCorridor = graph.getRegion(startId) >= 0 && graph.getRegion(endId) >= 0 &&
+                     graph.getRoadGraph().findCorridor(graph.getRegion(startId), graph.getRegion(endId),
+                                                       HIERARCHICAL_CORRIDOR_WIDTH, &corridor);
+  auto run = [&](auto heuristic) {
+    if (hasCorridor) {
+      KinematicSearch search(graph, ctx, heuristic, CorridorSuccessors(graph, corridor), NoConstraint(),
+                             PointGoal(endId), IterationBudget(), PoseStateKey());
+      if (search.run(startId) >= 0)
+        return;
+      spdlog::debug("No path inside the corridor, searching the whole graph");
+    }
+    KinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(), PointGoal(endId),
+                           IterationBudget(), PoseStateKey());
+    search.run(startId);
+  };
+  if (useLandmarks && graph.getNumLandmarks() > 0)
+    run(LandmarkHeuristic(graph, endId));
+  else
+    run(EuclideanHeuristic(graph, end));
+
+  collectStats(startTime, !ctx.path.empty());
+  return ctx.path;
 }
 
 void AStar::process() {
-  std::unordered_map<AStar::node, AStar::node> cameFrom;
-  std::unordered_map<AStar::node, double> gScore;
-  std::unordered_map<AStar::node, double> fScore;
-
-  auto heuristic = [&](const AStar::node &a) {
-    sf::Vector2f diff = end.point.position - a.point.position;
-    double distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-    return distance / CAR_MAX_SPEED_MS;
+  auto startTime = std::chrono::steady_clock::now();
+  processed = true;
+  if (backwardCtx.nodes.size() > 0)
+    backwardCtx.clear();
+
+  int endId = graph.getPointId(end.point);
+  if (endId < 0) {
+    ctx.clear();
+    collectStats(startTime, false);
+    return;
+  }
+
+  std::vector<node> cachedPath;
+  double cachedCost;
+  if (cache && cache->find(graph, start.point, end.point, &cachedPath, &cachedCost)) {
+    ctx.clear();
+    ctx.path = std::move(cachedPath);
+    ctx.pathCost = cachedCost;
+    collectStats(startTime, !ctx.path.empty());
+    return;
+  }
+
+  int startId = graph.getPointId(start.point);
+  auto run = [&](auto heuristic) {
+    if (dominancePruning) {
+      KinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(), PointGoal(endId),
+                             IterationBudget(), PoseStateKey());
+      search.run(startId);
+    } else {
+      KinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(), PointGoal(endId),
+                             IterationBudget(), EdgeStateKey());
+      search.run(startId);
+    }
   };
-  auto compare = [&](const AStar::node &a, const AStar::node &b) { return fScore[a] > fScore[b]; };
+  if (useLandmarks && graph.getNumLandmarks() > 0)
+    run(LandmarkHeuristic(graph, endId));
+  else
+    run(EuclideanHeuristic(graph, end.point));
 
-  std::priority_queue<AStar::node, std::vector<AStar::node>, decltype(compare)> openSetAstar(compare);
-  std::unordered_set<AStar::node> isInOpenSet;
+  // A search cut by its budget proves nothing: only a found path or an exhausted open set is cached
+  if (cache && (!ctx.path.empty() || ctx.openSet.empty()))
+    cache->insert(graph, start.point, end.point, ctx.path, ctx.pathCost);
+  collectStats(startTime, !ctx.path.empty());
+}
 
-  openSetAstar.push(start);
-  gScore[start] = 0;
-  fScore[start] = heuristic(start);
+void AStar::collectStats(std::chrono::steady_clock::time_point startTime, bool found) {
+  // Both sides of a bidirectional search, the backward one is empty otherwise
+  lastStats = ctx.stats;
+  lastStats += backwardCtx.stats;
+  lastStats.numSearches = 1;
+  lastStats.numFound = found;
+  lastStats.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  totalStats += lastStats;
+}
 
-  auto neighbors = graph.getNeighbors();
+/**
+ * @brief Expand the best state of one side of the bidirectional search
+ *
+ * The forward side follows the edges out of the point of the state. The backward side follows the edges into it: a
+ * backward state (point, edge, speed) means that the car leaves the point through the edge at this speed, and its
+ * g-score is the travel time from there to the end point. Every relaxed state is registered in the pose table of its
+ * side and matched against the pose table of the other side.
+ *
+ * @return The new best meeting cost
+ */
+template <bool BACKWARD, typename Heuristic>
+static double expandSide(const CityGraph &graph, _aStarContext &side, NodeTable &poses, NodeTable &otherPoses,
+                         const Heuristic &heuristic, const TableSuccessors &successors, double bestCost,
+                         int &bestForward, int &bestBackward) {
+  NodeTable &nodes = side.nodes;
+  int currentIndex = side.openSet.pop();
+  NodeTable::record &current = nodes[currentIndex];
+  current.closed = true;
+  side.stats.numExpansions++;
 
-  int nbIterations = 0;
-  while (!openSetAstar.empty() && nbIterations++ < ASTAR_MAX_ITERATIONS) {
-    AStar::node current = openSetAstar.top();
-    openSetAstar.pop();
-    isInOpenSet.erase(current);
+  const int currentPoint = current.key.point;
+  const double currentSpeed = current.speed;
+  const double currentG = current.g;
 
-    if (current.point == end.point) {
-      AStar::node currentCopy = current;
-      path.clear();
+  auto relax = [&](const CityGraph::edge &edge, int edgeId, double newSpeed, double duration) {
+    const int nextPoint = BACKWARD ? edge.from : edge.to;
+    const int bucket = getSpeedBucket(newSpeed);
+    double g = currentG + duration;
+    int index = relaxState(side, {nextPoint, edgeId, bucket}, currentIndex, edgeId, newSpeed, g);
+    if (index < 0)
+      return;
 
-      while (!(currentCopy == start)) {
-        path.push_back(currentCopy);
-        currentCopy = cameFrom[currentCopy];
-      }
+    NodeTable::record &neighbor = nodes[index];
+    neighbor.f = g + heuristic(nextPoint);
+    neighbor.closed = false;
+    side.openSet.push(index, neighbor.f);
+    side.stats.peakOpenSet = std::max(side.stats.peakOpenSet, (long long)side.openSet.size());
 
-      path.push_back(currentCopy);
-      std::reverse(path.begin(), path.end());
-      processed = true;
+    bool inserted;
+    int poseIndex = poses.findOrInsert({nextPoint, -1, bucket}, &inserted);
+    if (inserted || g < poses[poseIndex].g) {
+      poses[poseIndex].g = g;
+      poses[poseIndex].parent = index;
     }
 
-    for (const auto &neighborGraphPoint : neighbors[current.point]) {
-      if (current.speed > neighborGraphPoint.maxSpeed)
-        continue;
-
-      if (!neighborGraphPoint.isRightWay && ROAD_ENABLE_RIGHT_HAND_TRAFFIC)
-        continue;
-
-      std::vector<double> newSpeeds;
-      newSpeeds.push_back(current.speed);
-
-      double distance = graph.getInterpolator(current.point, neighborGraphPoint)->getDistance();
-      double nSpeedAcc = std::sqrt(std::pow(current.speed, 2) + 2 * CAR_ACCELERATION * distance);
-      double nSpeedDec = std::sqrt(std::pow(current.speed, 2) - 2 * CAR_DECELERATION * distance);
-
-      auto push = [&](double nSpeed) {
-        int numSpeedDiv = NUM_SPEED_DIVISIONS;
-        for (int i = 1; i < numSpeedDiv + 1; i++) {
-          double s = (current.speed + (nSpeed - current.speed) * i / numSpeedDiv);
-          if (s < SPEED_RESOLUTION)
-            continue;
-          newSpeeds.push_back(s);
-        }
-      };
-
-      if (nSpeedAcc > neighborGraphPoint.maxSpeed && current.speed < neighborGraphPoint.maxSpeed) {
-        push(neighborGraphPoint.maxSpeed);
-      } else if (nSpeedAcc < neighborGraphPoint.maxSpeed) {
-        push(nSpeedAcc);
-      }
-
-      if (nSpeedDec == nSpeedDec && std::isfinite(nSpeedDec)) { // check if nSpeedDec is finite and not NaN
-        if (nSpeedDec < 0 && current.speed > 0) {
-          push(0);
-        } else if (nSpeedDec >= 0) {
-          push(nSpeedDec);
-        }
-      }
-
-      AStar::node neighbor;
-      neighbor.point = neighborGraphPoint.point;
-      neighbor.arcFrom = {current.point, neighborGraphPoint};
-      if (distance == 0) {
-        neighbor.speed = current.speed;
-        if (gScore.find(neighbor) == gScore.end() || gScore[current] < gScore[neighbor]) {
-          cameFrom[neighbor] = current;
-          gScore[neighbor] = gScore[current];
-          fScore[neighbor] = gScore[neighbor] + heuristic(neighbor);
-
-          if (isInOpenSet.find(neighbor) == isInOpenSet.end()) {
-            openSetAstar.push(neighbor);
-
-            isInOpenSet.insert(neighbor);
-          }
-        }
-        continue;
-      }
-
-      for (const auto &newSpeed : newSpeeds) {
-        if (newSpeed > CAR_MAX_SPEED_MS || newSpeed > neighborGraphPoint.maxSpeed || newSpeed < 0)
-          continue;
-
-        if (newSpeed == current.speed && newSpeed == 0)
-          continue;
-
-        neighbor.speed = newSpeed;
-
-        double duration = 2 * distance / (current.speed + newSpeed);
-        double tentativeGScore = gScore[current] + duration;
-
-        double t = gScore[current];
-
-        if (gScore.find(neighbor) == gScore.end() || tentativeGScore < gScore[neighbor]) {
-          cameFrom[neighbor] = current;
-          gScore[neighbor] = tentativeGScore;
-          fScore[neighbor] = gScore[neighbor] + heuristic(neighbor);
-
-          if (isInOpenSet.find(neighbor) == isInOpenSet.end()) {
-            openSetAstar.push(neighbor);
-            isInOpenSet.insert(neighbor);
-          }
-        }
-      }
+    int otherIndex = otherPoses.find({nextPoint, -1, bucket});
+    if (otherIndex >= 0 && g + otherPoses[otherIndex].g < bestCost) {
+      bestCost = g + otherPoses[otherIndex].g;
+      bestForward = BACKWARD ? otherPoses[otherIndex].parent : index;
+      bestBackward = BACKWARD ? index : otherPoses[otherIndex].parent;
     }
+  };
+  forEachTraversal<BACKWARD>(graph, side, successors, currentPoint, currentSpeed, relax);
+
+  return bestCost;
+}
+
+template <typename Heuristic>
+void AStar::runBidirectional(int startId, int endId, const Heuristic &forwardHeuristic,
+                             const Heuristic &backwardHeuristic) {
+  TableSuccessors forwardSuccessors(graph);
+  TableSuccessors backwardSuccessors(graph, true);
+
+  bool inserted;
+  int forwardStart = ctx.nodes.findOrInsert({startId, -1, 0}, &inserted);
+  ctx.nodes[forwardStart].f = forwardHeuristic(startId);
+  ctx.openSet.push(forwardStart, ctx.nodes[forwardStart].f);
+  forwardPoses[forwardPoses.findOrInsert({startId, -1, 0}, &inserted)].parent = forwardStart;
+
+  int backwardStart = backwardCtx.nodes.findOrInsert({endId, -1, 0}, &inserted);
+  backwardCtx.nodes[backwardStart].f = backwardHeuristic(endId);
+  backwardCtx.openSet.push(backwardStart, backwardCtx.nodes[backwardStart].f);
+  backwardPoses[backwardPoses.findOrInsert({endId, -1, 0}, &inserted)].parent = backwardStart;
+
+  double bestCost = std::numeric_limits<double>::infinity();
+  int bestForward = -1;
+  int bestBackward = -1;
+  if (startId == endId) {
+    bestCost = 0;
+    bestForward = forwardStart;
+    bestBackward = backwardStart;
+  }
+
+  for (int numIterations = 0; numIterations < ASTAR_MAX_ITERATIONS; numIterations++) {
+    if (ctx.openSet.empty() || backwardCtx.openSet.empty())
+      break;
+    // Every path cheaper than the best meeting crosses both open sets, so it is bounded by both smallest f-scores
+    if (std::max(ctx.openSet.topKey(), backwardCtx.openSet.topKey()) >= bestCost)
+      break;
+
+    if (ctx.openSet.size() <= backwardCtx.openSet.size())
+      bestCost = expandSide<false>(graph, ctx, forwardPoses, backwardPoses, forwardHeuristic, forwardSuccessors,
+                                   bestCost, bestForward, bestBackward);
+    else
+      bestCost = expandSide<true>(graph, backwardCtx, backwardPoses, forwardPoses, backwardHeuristic,
+                                  backwardSuccessors, bestCost, bestForward, bestBackward);
   }
+
+  if (bestForward < 0)
+    return;
+
+  // Forward half from the start to the meeting pose, then the backward records in order of their departure edges
+  ctx.reconstructPath(graph, bestForward);
+  for (int index = bestBackward; backwardCtx.nodes[index].parent >= 0; index = backwardCtx.nodes[index].parent) {
+    const CityGraph::edge &edge = graph.getEdge(backwardCtx.nodes[index].edge);
+    node n{};
+    n.point = graph.getPoint(edge.to);
+    n.speed = backwardCtx.nodes[backwardCtx.nodes[index].parent].speed;
+    n.arcFrom = {graph.getPoint(edge.from), edge.neighbor};
+    ctx.path.push_back(n);
+  }
+  ctx.pathCost = bestCost;
+}
+
+void AStar::processBidirectional() {
+  auto startTime = std::chrono::steady_clock::now();
+  processed = true;
+  ctx.clear();
+  backwardCtx.clear();
+  forwardPoses.clear();
+  backwardPoses.clear();
+
+  int startId = graph.getPointId(start.point);
+  int endId = graph.getPointId(end.point);
+  if (startId >= 0 && endId >= 0) {
+    if (useLandmarks && graph.getNumLandmarks() > 0)
+      runBidirectional(startId, endId, LandmarkHeuristic(graph, endId), LandmarkHeuristic(graph, startId, true));
+    else
+      runBidirectional(startId, endId, EuclideanHeuristic(graph, end.point), EuclideanHeuristic(graph, start.point));
+  }
+
+  ctx.stats.numProbes = ctx.nodes.getNumProbes() + forwardPoses.getNumProbes();
+  backwardCtx.stats.numProbes = backwardCtx.nodes.getNumProbes() + backwardPoses.getNumProbes();
+  collectStats(startTime, !ctx.path.empty());
 }
@@ -0,0 +1,815 @@
+/**
+ * @file benchmark.cpp
+ * @brief Benchmarks of the path planning algorithms
+ *
+ * This file contains the implementation of the Benchmark class.
+ */
+#include "benchmark.h"
+#include "aStar.h"
+#include "car.h"
+#include "conflictDetector.h"
+#include "indexedHeap.h"
+#include "kinematicSearch.h"
+#include "reservationIndex.h"
+#include "routeCache.h"
+#include "routePlanner.h"
+#include "safeIntervalSearch.h"
+#include "threadPool.h"
+#include "trajectoryBuffer.h"
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <set>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+#include <unordered_set>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Benchmark::run(int numQueries) {
+  spdlog::info("Running benchmarks with {} queries (seed {})", numQueries, seed);
+  benchmarkOpenSet(BENCHMARK_OPEN_SET_OPERATIONS);
+  benchmarkSuccessors(BENCHMARK_SUCCESSOR_PASSES);
+  for (int numAgents = BENCHMARK_CONFLICT_MAX_AGENTS / 16; numAgents <= BENCHMARK_CONFLICT_MAX_AGENTS; numAgents *= 2)
+    benchmarkConflicts(numAgents, BENCHMARK_CONFLICT_STEPS);
+  benchmarkReservations(BENCHMARK_RESERVATIONS, BENCHMARK_RESERVATION_EDGES);
+  benchmarkSafeIntervals(numQueries, BENCHMARK_SAFE_INTERVAL_LEADERS);
+  benchmarkFocal(numQueries, BENCHMARK_SAFE_INTERVAL_LEADERS, BENCHMARK_ECBS_SUBOPTIMALITY);
+  benchmarkSearch(numQueries);
+  benchmarkDominance(numQueries);
+  benchmarkAnytime(numQueries, BENCHMARK_ANYTIME_BUDGET);
+  benchmarkLandmarks(numQueries);
+  benchmarkBidirectional(numQueries);
+  benchmarkHierarchical(numQueries);
+  benchmarkOneToMany(numQueries);
+  benchmarkRouteCache(numQueries);
+  benchmarkPlanner(numQueries);
+}
+
+int Benchmark::addLeaders(const std::vector<sf::Vector2f> &samples, int numLeaders, ReservationIndex *index) const {
+  // The leaders drive the route 1.5 to 2.5 times slower, starting 2, 4... seconds ahead
+  int numReservations = 0;
+  for (int leader = 0; leader < numLeaders; leader++) {
+    double slowdown = 1.5 + 0.5 * (leader % 3);
+    double ahead = 2.0 * (leader + 1);
+    for (int i = 0; i < (int)samples.size(); i++) {
+      double time = i * SIM_STEP_TIME * slowdown - ahead;
+      if (time >= 0) {
+        index->add(time, samples[i]);
+        numReservations++;
+      }
+    }
+  }
+  index->build();
+  return numReservations;
+}
+
+std::vector<Benchmark::query> Benchmark::createQueries(int numQueries) const {
+  std::mt19937 gen(seed);
+  std::vector<query> queries;
+  queries.reserve(numQueries);
+
+  // Same constraint as Car::chooseRandomStartEndPath: the points are at least half the map apart
+  double minDistance = std::max(graph.getWidth(), graph.getHeight()) / 2.0;
+  while ((int)queries.size() < numQueries) {
+    CityGraph::point start = graph.getRandomPoint(gen);
+    CityGraph::point end = graph.getRandomPoint(gen);
+    sf::Vector2f diff = start.position - end.position;
+    if (std::sqrt(diff.x * diff.x + diff.y * diff.y) < minDistance)
+      continue;
+    queries.push_back({start, end});
+  }
+
+  return queries;
+}
+
+ConflictDetector::paths Benchmark::createTrajectories(int numAgents, int numSteps) const {
+  // Straight lines at random speeds over the map, ending at random steps as if the cars had arrived
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> xDis(0, graph.getWidth());
+  std::uniform_real_distribution<float> yDis(0, graph.getHeight());
+  std::uniform_real_distribution<float> angleDis(0, 2 * M_PI);
+  std::uniform_real_distribution<float> speedDis(0, CAR_MAX_SPEED_MS * SIM_STEP_TIME);
+  std::uniform_int_distribution<int> lengthDis(numSteps / 2, numSteps);
+
+  ConflictDetector::paths trajectories(numAgents);
+  for (auto &trajectory : trajectories) {
+    sf::Vector2f position(xDis(gen), yDis(gen));
+    float angle = angleDis(gen);
+    float speed = speedDis(gen);
+    sf::Vector2f step(speed * std::cos(angle), speed * std::sin(angle));
+    std::vector<sf::Vector2f> points(lengthDis(gen));
+    for (auto &p : points) {
+      p = position;
+      position += step;
+    }
+    trajectory = std::make_shared<const std::vector<sf::Vector2f>>(std::move(points));
+  }
+
+  return trajectories;
+}
+
+void Benchmark::benchmarkSearch(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  long long totalExpansions = 0;
+  long long totalStates = 0;
+  std::size_t peakMemory = 0;
+  int numFound = 0;
+  auto startTime = std::chrono::steady_clock::now();
+  for (const auto &[start, end] : queries) {
+    if (!aStar.findPath(start, end).empty())
+      numFound++;
+    totalExpansions += aStar.getNumExpansions();
+    totalStates += aStar.getNumStates();
+    peakMemory = std::max(peakMemory, aStar.getMemoryUsage());
+  }
+  double elapsed = secondsSince(startTime);
+
+  spdlog::info("A*: {} queries ({} found) in {:.3f}s, {} expansions, {:.0f} expansions/s", numQueries, numFound,
+               elapsed, totalExpansions, totalExpansions / std::max(elapsed, 1e-9));
+  spdlog::info("A*: {} states reached, node table peak {} KB ({:.1f} bytes/state)", totalStates, peakMemory / 1024,
+               (double)peakMemory * numQueries / std::max(totalStates, 1LL));
+  spdlog::info("A* stats: {}", aStar.getTotalStats().toJson());
+}
+
+void Benchmark::benchmarkBidirectional(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  long long expansions[2] = {0, 0};
+  double elapsed[2] = {0, 0};
+  int numFound[2] = {0, 0};
+  int numCostMismatches = 0;
+  int numBoth = 0;
+  double stopCost = 0;
+  for (const auto &[start, end] : queries) {
+    auto startTime = std::chrono::steady_clock::now();
+    bool found = !aStar.findPath(start, end).empty();
+    elapsed[0] += secondsSince(startTime);
+    expansions[0] += aStar.getNumExpansions();
+    numFound[0] += found;
+    double cost = aStar.getPathCost();
+
+    startTime = std::chrono::steady_clock::now();
+    bool foundBidirectional = !aStar.findPathBidirectional(start, end).empty();
+    elapsed[1] += secondsSince(startTime);
+    expansions[1] += aStar.getNumExpansions();
+    numFound[1] += foundBidirectional;
+
+    // The bidirectional path stops at the end point and findPath's does not, so it may only be slower
+    if (found && foundBidirectional) {
+      numBoth++;
+      stopCost += aStar.getPathCost() - cost;
+      if (aStar.getPathCost() < cost - 1e-6 * std::max(cost, 1.0))
+        numCostMismatches++;
+    }
+  }
+
+  spdlog::info("Unidirectional A*: {} queries ({} found) in {:.3f}s, {} expansions", numQueries, numFound[0],
+               elapsed[0], expansions[0]);
+  spdlog::info("Bidirectional A*: {} queries ({} found) in {:.3f}s, {} expansions ({:.2f}x fewer), {:.3f}s more per "
+               "query to stop at the end, {} paths faster than the unidirectional ones",
+               numQueries, numFound[1], elapsed[1], expansions[1],
+               (double)expansions[0] / std::max(expansions[1], 1LL), stopCost / std::max(numBoth, 1),
+               numCostMismatches);
+}
+
+void Benchmark::benchmarkHierarchical(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  long long expansions[2] = {0, 0};
+  double elapsed[2] = {0, 0};
+  int numFound[2] = {0, 0};
+  double sumRatio = 0;
+  double maxRatio = 1;
+  int numCompared = 0;
+  for (const auto &[start, end] : queries) {
+    auto startTime = std::chrono::steady_clock::now();
+    bool found = !aStar.findPath(start, end).empty();
+    elapsed[0] += secondsSince(startTime);
+    expansions[0] += aStar.getNumExpansions();
+    numFound[0] += found;
+    double cost = aStar.getPathCost();
+
+    startTime = std::chrono::steady_clock::now();
+    bool foundHierarchical = !aStar.findPathHierarchical(start, end).empty();
+    elapsed[1] += secondsSince(startTime);
+    expansions[1] += aStar.getNumExpansions();
+    numFound[1] += foundHierarchical;
+
+    if (found && foundHierarchical && cost > 0) {
+      double ratio = aStar.getPathCost() / cost;
+      sumRatio += ratio;
+      maxRatio = std::max(maxRatio, ratio);
+      numCompared++;
+    }
+  }
+
+  spdlog::info("Road graph: {} segments", graph.getRoadGraph().getNumNodes());
+  spdlog::info("Flat A*: {} queries ({} found) in {:.3f}s, {} expansions", numQueries, numFound[0], elapsed[0],
+               expansions[0]);
+  spdlog::info("Hierarchical A*: {} queries ({} found) in {:.3f}s, {} expansions ({:.2f}x fewer), cost ratio mean "
+               "{:.3f} max {:.3f}",
+               numQueries, numFound[1], elapsed[1], expansions[1],
+               (double)expansions[0] / std::max(expansions[1], 1LL), sumRatio / std::max(numCompared, 1), maxRatio);
+}
+
+void Benchmark::benchmarkAnytime(int numQueries, double timeBudget) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  double elapsed[2] = {0, 0};
+  int numFound[2] = {0, 0};
+  double sumBound = 0;
+  double maxBound = 1;
+  double sumRatio = 0;
+  int numCompared = 0;
+  for (const auto &[start, end] : queries) {
+    auto startTime = std::chrono::steady_clock::now();
+    bool found = !aStar.findPath(start, end).empty();
+    elapsed[0] += secondsSince(startTime);
+    double optimalCost = aStar.getPathCost();
+    numFound[0] += found;
+
+    startTime = std::chrono::steady_clock::now();
+    bool foundAnytime = !aStar.findPathAnytime(start, end, timeBudget).empty();
+    elapsed[1] += secondsSince(startTime);
+    if (!foundAnytime)
+      continue;
+
+    numFound[1]++;
+    sumBound += aStar.getSuboptimalityBound();
+    maxBound = std::max(maxBound, aStar.getSuboptimalityBound());
+    if (found && optimalCost > 0) {
+      sumRatio += aStar.getPathCost() / optimalCost;
+      numCompared++;
+    }
+  }
+
+  spdlog::info("A*: {} queries ({} found) in {:.3f}s", numQueries, numFound[0], elapsed[0]);
+  spdlog::info("ARA* ({:.3f}s budget): {} queries ({} found) in {:.3f}s, bound {:.3f} on average ({:.3f} max), cost "
+               "{:.3f}x the optimal on average",
+               timeBudget, numQueries, numFound[1], elapsed[1], sumBound / std::max(numFound[1], 1), maxBound,
+               numCompared > 0 ? sumRatio / numCompared : 1.0);
+}
+
+void Benchmark::benchmarkDominance(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  long long states[2] = {0, 0};
+  long long expansions[2] = {0, 0};
+  double elapsed[2] = {0, 0};
+  int numCostMismatches = 0;
+  for (const auto &[start, end] : queries) {
+    double costs[2] = {0, 0};
+    for (int pruning = 0; pruning < 2; pruning++) {
+      aStar.setDominancePruning(pruning);
+      auto startTime = std::chrono::steady_clock::now();
+      aStar.findPath(start, end);
+      elapsed[pruning] += secondsSince(startTime);
+      states[pruning] += aStar.getNumStates();
+      expansions[pruning] += aStar.getNumExpansions();
+      costs[pruning] = aStar.getPathCost();
+    }
+
+    // Merging the arrival edges does not change the successors of a state. The merged state keeps the exact speed of
+    // the best arrival, so costs may only differ by the speed quantization
+    if (std::abs(costs[0] - costs[1]) > 1e-3 * std::max(costs[0], 1.0))
+      numCostMismatches++;
+  }
+
+  spdlog::info("Per-edge states: {} queries in {:.3f}s, {} states, {} expansions", numQueries, elapsed[0], states[0],
+               expansions[0]);
+  spdlog::info("Dominance pruning: {} queries in {:.3f}s, {} states ({:.1f}% fewer), {} expansions, {} cost mismatches",
+               numQueries, elapsed[1], states[1], 100.0 * (1.0 - (double)states[1] / std::max(states[0], 1LL)),
+               expansions[1], numCostMismatches);
+}
+
+void Benchmark::benchmarkLandmarks(int numQueries) {
+  if (graph.getNumLandmarks() == 0) {
+    spdlog::info("ALT: no landmarks computed, skipped");
+    return;
+  }
+
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+
+  long long expansions[2] = {0, 0};
+  double elapsed[2] = {0, 0};
+  int numCostMismatches = 0;
+  for (const auto &[start, end] : queries) {
+    double costs[2] = {0, 0};
+    for (int useLandmarks = 0; useLandmarks < 2; useLandmarks++) {
+      aStar.setUseLandmarks(useLandmarks);
+      auto startTime = std::chrono::steady_clock::now();
+      aStar.findPath(start, end);
+      elapsed[useLandmarks] += secondsSince(startTime);
+      expansions[useLandmarks] += aStar.getNumExpansions();
+      costs[useLandmarks] = aStar.getPathCost();
+    }
+
+    // Both heuristics are admissible, so both searches must find paths of the same cost
+    if (std::abs(costs[0] - costs[1]) > 1e-6 * std::max(costs[0], 1.0))
+      numCostMismatches++;
+  }
+
+  spdlog::info("Euclidean A*: {} queries in {:.3f}s, {} expansions", numQueries, elapsed[0], expansions[0]);
+  spdlog::info("ALT A* ({} landmarks): {} queries in {:.3f}s, {} expansions ({:.1f}% fewer), {} cost mismatches",
+               graph.getNumLandmarks(), numQueries, elapsed[1], expansions[1],
+               100.0 * (1.0 - (double)expansions[1] / std::max(expansions[0], 1LL)), numCostMismatches);
+}
+
+void Benchmark::benchmarkOneToMany(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  if (queries.empty())
+    return;
+
+  // Depot workload: every query leaves from the start point of the first one
+  CityGraph::point depot = queries.front().first;
+  std::vector<CityGraph::point> ends;
+  for (const auto &[start, end] : queries)
+    ends.push_back(end);
+
+  AStar aStar(graph);
+  std::vector<double> costs(ends.size());
+  long long expansions = 0;
+  auto startTime = std::chrono::steady_clock::now();
+  for (int i = 0; i < (int)ends.size(); i++) {
+    aStar.findPath(depot, ends[i]);
+    costs[i] = aStar.getPathCost();
+    expansions += aStar.getNumExpansions();
+  }
+  double elapsedQueries = secondsSince(startTime);
+
+  std::vector<double> oneToManyCosts;
+  startTime = std::chrono::steady_clock::now();
+  std::vector<std::vector<AStar::node>> paths = aStar.findPaths(depot, ends, &oneToManyCosts);
+  double elapsedOneToMany = secondsSince(startTime);
+
+  int numFound = 0;
+  int numCostMismatches = 0;
+  for (int i = 0; i < (int)ends.size(); i++) {
+    if (paths[i].empty())
+      continue;
+    numFound++;
+    if (std::abs(costs[i] - oneToManyCosts[i]) > 1e-6 * std::max(costs[i], 1.0))
+      numCostMismatches++;
+  }
+
+  spdlog::info("One-to-many: {} A* queries in {:.3f}s ({} expansions), one search in {:.3f}s ({} expansions, {} "
+               "found), {} cost mismatches",
+               ends.size(), elapsedQueries, expansions, elapsedOneToMany, aStar.getNumExpansions(), numFound,
+               numCostMismatches);
+}
+
+void Benchmark::benchmarkRouteCache(int numQueries) {
+  std::vector<query> queries = createQueries(numQueries);
+  RouteCache cache;
+  AStar aStar(graph);
+  aStar.setCache(&cache);
+
+  // The first pass fills the cache, the second one only hits it
+  double elapsed[2] = {0, 0};
+  for (int pass = 0; pass < 2; pass++) {
+    auto startTime = std::chrono::steady_clock::now();
+    for (const auto &[start, end] : queries)
+      aStar.findPath(start, end);
+    elapsed[pass] = secondsSince(startTime);
+  }
+
+  spdlog::info("Route cache: {} queries in {:.3f}s cold, {:.6f}s warm ({:.0f}x), {} hits, {} misses", numQueries,
+               elapsed[0], elapsed[1], elapsed[0] / std::max(elapsed[1], 1e-9), cache.getNumHits(),
+               cache.getNumMisses());
+}
+
+void Benchmark::benchmarkPlanner(int numQueries) {
+  RoutePlanner sequential(graph, 1);
+  auto startTime = std::chrono::steady_clock::now();
+  std::vector<RoutePlanner::route> sequentialRoutes = sequential.planRandomRoutes(numQueries, seed);
+  double elapsedSequential = secondsSince(startTime);
+
+  RoutePlanner parallel(graph);
+  startTime = std::chrono::steady_clock::now();
+  std::vector<RoutePlanner::route> parallelRoutes = parallel.planRandomRoutes(numQueries, seed);
+  double elapsedParallel = secondsSince(startTime);
+
+  // The routes only depend on the seed and their index, so both runs must agree
+  int numMismatches = 0;
+  for (int i = 0; i < numQueries; i++) {
+    const RoutePlanner::route &a = sequentialRoutes[i];
+    const RoutePlanner::route &b = parallelRoutes[i];
+    if (!(a.start == b.start) || !(a.end == b.end) || a.path.size() != b.path.size())
+      numMismatches++;
+  }
+
+  spdlog::info("Route planner: {} routes in {:.3f}s on 1 thread, {:.3f}s on {} threads ({:.2f}x), {} mismatches",
+               numQueries, elapsedSequential, elapsedParallel, parallel.getNumThreads(),
+               elapsedSequential / std::max(elapsedParallel, 1e-9), numMismatches);
+}
+
+void Benchmark::benchmarkOpenSet(int numOperations) {
+  // The same random trace of pushes, key improvements and pops is replayed on both open sets
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> keyDis(0, 1000);
+  int numIds = std::max(1, numOperations / 4);
+  std::uniform_int_distribution<int> idDis(0, numIds - 1);
+  std::vector<std::pair<int, double>> trace;
+  trace.reserve(numOperations);
+  for (int i = 0; i < numOperations; i++)
+    trace.push_back({idDis(gen), keyDis(gen)});
+
+  // Previous open set: a priority queue comparing f-scores stored in a hash map, plus an "is in open set" table
+  auto startTime = std::chrono::steady_clock::now();
+  {
+    std::unordered_map<int, double> fScore;
+    std::unordered_set<int> isInOpenSet;
+    auto compare = [&](int a, int b) { return fScore[a] > fScore[b]; };
+    std::priority_queue<int, std::vector<int>, decltype(compare)> openSet(compare);
+    for (int i = 0; i < numOperations; i++) {
+      const auto &[id, key] = trace[i];
+      if (fScore.find(id) == fScore.end() || key < fScore[id]) {
+        fScore[id] = key;
+        if (isInOpenSet.find(id) == isInOpenSet.end()) {
+          openSet.push(id);
+          isInOpenSet.insert(id);
+        }
+      }
+      if (i % 2 == 1 && !openSet.empty()) {
+        isInOpenSet.erase(openSet.top());
+        openSet.pop();
+      }
+    }
+  }
+  double elapsedPriorityQueue = secondsSince(startTime);
+
+  startTime = std::chrono::steady_clock::now();
+  {
+    std::vector<double> fScore(numIds, -1);
+    IndexedHeap<> openSet;
+    openSet.reserve(numIds);
+    for (int i = 0; i < numOperations; i++) {
+      const auto &[id, key] = trace[i];
+      if (fScore[id] < 0 || key < fScore[id]) {
+        fScore[id] = key;
+        openSet.push(id, key);
+      }
+      if (i % 2 == 1 && !openSet.empty())
+        openSet.pop();
+    }
+  }
+  double elapsedIndexedHeap = secondsSince(startTime);
+
+  spdlog::info("Open set: priority queue {:.3f}s, indexed heap {:.3f}s ({:.2f}x) for {} operations",
+               elapsedPriorityQueue, elapsedIndexedHeap, elapsedPriorityQueue / std::max(elapsedIndexedHeap, 1e-9),
+               numOperations);
+}
+
+void Benchmark::benchmarkSuccessors(int numPasses) {
+  // Every edge is expanded from every entry speed it allows, as the searches do
+  KinematicSuccessors kinematic;
+  TableSuccessors table(graph);
+  long long transitions[2] = {0, 0};
+  double sumDurations[2] = {0, 0};
+  double elapsed[2] = {0, 0};
+  for (int i = 0; i < 2; i++) {
+    auto startTime = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < numPasses; pass++) {
+      for (int edgeId = 0; edgeId < graph.getNumEdges(); edgeId++) {
+        const CityGraph::edge &edge = graph.getEdge(edgeId);
+        for (int bucket = 0; bucket <= edge.maxSpeedBucket; bucket++) {
+          auto visit = [&](double, double duration) {
+            transitions[i]++;
+            sumDurations[i] += duration;
+          };
+          if (i == 0)
+            kinematic(edge, bucket * SPEED_RESOLUTION, visit);
+          else
+            table(edge, bucket * SPEED_RESOLUTION, visit);
+        }
+      }
+    }
+    elapsed[i] = secondsSince(startTime);
+  }
+
+  // The edges shorter than the length resolution have tables of their exact length: they must match the computed
+  // transitions, rounded towards the entry speed like the tables
+  int numShortEdges = 0;
+  int mismatches = 0;
+  for (int edgeId = 0; edgeId < graph.getNumEdges(); edgeId++) {
+    const CityGraph::edge &edge = graph.getEdge(edgeId);
+    if (edge.distance <= 0 || edge.distance >= TRANSITION_LENGTH_RESOLUTION)
+      continue;
+    numShortEdges++;
+    for (int bucket = 0; bucket <= edge.maxSpeedBucket; bucket++) {
+      double speed = bucket * SPEED_RESOLUTION;
+      std::set<int> computed, tabled;
+      kinematic(edge, speed, [&](double newSpeed, double) {
+        int newBucket = bucket;
+        if (newSpeed > speed)
+          newBucket = (int)std::floor(newSpeed / SPEED_RESOLUTION + 1e-9);
+        else if (newSpeed < speed)
+          newBucket = (int)std::ceil(newSpeed / SPEED_RESOLUTION - 1e-9);
+        if (newBucket <= edge.maxSpeedBucket)
+          computed.insert(newBucket);
+      });
+      auto [first, last] = graph.getSpeedTransitions(edge, bucket, false);
+      tabled.insert(first, last);
+      mismatches += computed != tabled;
+    }
+  }
+
+  // The sum of the durations keeps the loops from being optimized away
+  spdlog::info("Successors: computed {:.3f}s ({} transitions, {:.0f}s total), tables {:.3f}s ({} transitions, {:.0f}s "
+               "total), {:.2f}x faster, {} mismatches on {} edges shorter than the length resolution",
+               elapsed[0], transitions[0], sumDurations[0], elapsed[1], transitions[1], sumDurations[1],
+               elapsed[0] / std::max(elapsed[1], 1e-9), mismatches, numShortEdges);
+}
+
+void Benchmark::benchmarkConflicts(int numAgents, int numSteps) {
+  ConflictDetector::paths trajectories = createTrajectories(numAgents, numSteps);
+  ConflictDetector detector;
+  ThreadPool pool(CONFLICT_NUM_THREADS);
+
+  // Up to 10 rounds: each conflict found is removed by ending the path of the second car there, like an arrival
+  // The incremental check scans every pair once, then only rechecks the car whose path was cut
+  int numConflicts = 0;
+  double elapsed[5] = {0, 0, 0, 0, 0};
+  int numMismatches = 0;
+  std::vector<ConflictDetector::pair> pairs;
+  auto startTime = std::chrono::steady_clock::now();
+  detector.findConflicts(trajectories, &pairs);
+  double fullScanTime = secondsSince(startTime);
+  for (int round = 0; round < 10; round++) {
+    int car1[5], car2[5], time[5];
+    bool found[5];
+    startTime = std::chrono::steady_clock::now();
+    found[0] = detector.findFirstConflictBruteForce(trajectories, &car1[0], &car2[0], &time[0]);
+    elapsed[0] += secondsSince(startTime);
+
+    startTime = std::chrono::steady_clock::now();
+    found[1] = detector.findFirstConflictGrid(trajectories, &car1[1], &car2[1], &time[1]);
+    elapsed[1] += secondsSince(startTime);
+
+    startTime = std::chrono::steady_clock::now();
+    found[2] = detector.findFirstConflictSimd(trajectories, &car1[2], &car2[2], &time[2]);
+    elapsed[2] += secondsSince(startTime);
+
+    startTime = std::chrono::steady_clock::now();
+    found[3] = detector.findFirstConflictParallel(trajectories, pool, &car1[3], &car2[3], &time[3]);
+    elapsed[3] += secondsSince(startTime);
+
+    found[4] = !pairs.empty();
+    if (found[4]) {
+      car1[4] = pairs.front().car1;
+      car2[4] = pairs.front().car2;
+      time[4] = pairs.front().time;
+    }
+
+    for (int i = 1; i < 5; i++)
+      if (found[i] != found[0] || (found[0] && (car1[i] != car1[0] || car2[i] != car2[0] || time[i] != time[0])))
+        numMismatches++;
+    if (!found[0])
+      break;
+    numConflicts++;
+    const std::vector<sf::Vector2f> &cut = *trajectories[car2[0]];
+    trajectories[car2[0]] = std::make_shared<const std::vector<sf::Vector2f>>(cut.begin(), cut.begin() + time[0]);
+
+    startTime = std::chrono::steady_clock::now();
+    detector.updateConflicts(trajectories, car2[0], &pairs);
+    elapsed[4] += secondsSince(startTime);
+  }
+
+  spdlog::info("Conflicts: {} cars, {} steps, brute force {:.3f}s, grid {:.3f}s ({:.2f}x), simd ({}) {:.3f}s "
+               "({:.2f}x), parallel ({} threads) {:.3f}s ({:.2f}x), incremental {:.3f}s + {:.4f}s per update, {} "
+               "conflicts, {} mismatches",
+               numAgents, numSteps, elapsed[0], elapsed[1], elapsed[0] / std::max(elapsed[1], 1e-9),
+               getTrajectoryKernelName(), elapsed[2], elapsed[0] / std::max(elapsed[2], 1e-9), pool.getNumThreads(),
+               elapsed[3], elapsed[0] / std::max(elapsed[3], 1e-9), fullScanTime,
+               elapsed[4] / std::max(numConflicts, 1), numConflicts, numMismatches);
+}
+
+void Benchmark::benchmarkReservations(int numConstraints, int numEdges) {
+  // The constraints of a car replanned many times in a dense fleet, spread over the map and a minute
+  const double horizon = 60;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> xDis(0, graph.getWidth());
+  std::uniform_real_distribution<float> yDis(0, graph.getHeight());
+  std::uniform_real_distribution<double> timeDis(0, horizon);
+  std::uniform_real_distribution<float> angleDis(0, 2 * M_PI);
+  std::uniform_real_distribution<double> durationDis(0.5, 3);
+
+  std::unordered_map<int, std::vector<sf::Vector2f>> buckets;
+  ReservationIndex index;
+  for (int i = 0; i < numConstraints; i++) {
+    double time = timeDis(gen);
+    sf::Vector2f position(xDis(gen), yDis(gen));
+    buckets[ReservationIndex::getBucket(time)].push_back(position);
+    index.add(time, position);
+  }
+  index.build();
+
+  typedef struct {
+    double time;
+    double duration;
+    sf::Vector2f start;
+    sf::Vector2f step;
+  } traversal;
+  std::vector<traversal> edges(numEdges);
+  for (auto &edge : edges) {
+    float angle = angleDis(gen);
+    float speed = CAR_MAX_SPEED_MS * SIM_STEP_TIME;
+    edge = {timeDis(gen), durationDis(gen), {xDis(gen), yDis(gen)}, {speed * std::cos(angle), speed * std::sin(angle)}};
+  }
+
+  const float range = CAR_LENGTH * COLLISION_SAFETY_FACTOR;
+  double elapsed[2] = {0, 0};
+  int numBlocked[2] = {0, 0};
+  int numMismatches = 0;
+  for (const auto &edge : edges) {
+    // Scan of every constraint of the time bucket of each sample
+    auto startTime = std::chrono::steady_clock::now();
+    bool blocked[2] = {false, false};
+    sf::Vector2f position = edge.start;
+    for (double tt = 0; tt < edge.duration && !blocked[0]; tt += SIM_STEP_TIME, position += edge.step) {
+      auto bucket = buckets.find(ReservationIndex::getBucket(edge.time + tt));
+      if (bucket == buckets.end())
+        continue;
+      for (const sf::Vector2f &constraint : bucket->second) {
+        sf::Vector2f diff = position - constraint;
+        if (diff.x * diff.x + diff.y * diff.y < range * range) {
+          blocked[0] = true;
+          break;
+        }
+      }
+    }
+    elapsed[0] += secondsSince(startTime);
+
+    // Reservation index, as in the OCBS constraint policy
+    startTime = std::chrono::steady_clock::now();
+    if (index.overlaps(edge.time, edge.time + edge.duration)) {
+      position = edge.start;
+      for (double tt = 0; tt < edge.duration && !blocked[1]; tt += SIM_STEP_TIME, position += edge.step) {
+        int bucket = ReservationIndex::getBucket(edge.time + tt);
+        blocked[1] = index.hasBucket(bucket) && index.isBlocked(bucket, position);
+      }
+    }
+    elapsed[1] += secondsSince(startTime);
+
+    numBlocked[0] += blocked[0];
+    numBlocked[1] += blocked[1];
+    numMismatches += blocked[0] != blocked[1];
+  }
+
+  spdlog::info("Reservations: {} constraints, {} edges, bucket scan {:.3f}s, index {:.3f}s ({:.2f}x), {} blocked, {} "
+               "mismatches",
+               numConstraints, numEdges, elapsed[0], elapsed[1], elapsed[0] / std::max(elapsed[1], 1e-9), numBlocked[0],
+               numMismatches);
+}
+
+void Benchmark::benchmarkSafeIntervals(int numQueries, int numLeaders) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+  AStar::context ctx;
+
+  double elapsed[2] = {0, 0};
+  long long expansions[2] = {0, 0};
+  int numFound[2] = {0, 0};
+  double costs[2] = {0, 0};
+  int numBoth = 0;
+  int numConstraints = 0;
+  for (const auto &[start, end] : queries) {
+    std::vector<AStar::node> route = aStar.findPath(start, end);
+    int startId = graph.getPointId(start);
+    int endId = graph.getPointId(end);
+    if (route.empty() || startId < 0 || endId < 0)
+      continue;
+
+    Car car;
+    car.assignPath(route, graph);
+    ReservationIndex index;
+    numConstraints += addLeaders(car.getPath(), numLeaders, &index);
+
+    TableHeuristic heuristic(graph.computeTravelTimes(endId, true));
+    double queryCosts[2] = {0, 0};
+    bool found[2] = {false, false};
+    for (int sipp = 0; sipp < 2; sipp++) {
+      auto startTime = std::chrono::steady_clock::now();
+      if (sipp) {
+        SafeIntervals intervals(graph, index);
+        SafeIntervalSearch search(graph, ctx, intervals, heuristic, TableSuccessors(graph),
+                                  ReservationConstraint(index), PointGoal(endId), IterationBudget());
+        found[sipp] = search.run(startId) >= 0;
+      } else {
+        KinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), ReservationConstraint(index),
+                               PointGoal(endId), IterationBudget(), TimedPoseStateKey());
+        found[sipp] = search.run(startId) >= 0;
+      }
+      elapsed[sipp] += secondsSince(startTime);
+      expansions[sipp] += ctx.stats.numExpansions;
+      numFound[sipp] += found[sipp];
+      queryCosts[sipp] = ctx.pathCost;
+    }
+
+    // Costs are only compared on the queries both low levels solved
+    if (found[0] && found[1]) {
+      numBoth++;
+      costs[0] += queryCosts[0];
+      costs[1] += queryCosts[1];
+    }
+  }
+
+  spdlog::info("Safe intervals: {} queries, {} constraints from {} slower car(s) ahead", numQueries, numConstraints,
+               numLeaders);
+  spdlog::info("Kinematic low level: {:.3f}s, {} expansions, {} found", elapsed[0], expansions[0], numFound[0]);
+  spdlog::info("SIPP low level: {:.3f}s ({:.2f}x), {} expansions, {} found, cost {:+.2f}% on the {} queries both "
+               "solved",
+               elapsed[1], elapsed[0] / std::max(elapsed[1], 1e-9), expansions[1], numFound[1],
+               100.0 * (costs[1] / std::max(costs[0], 1e-9) - 1), numBoth);
+}
+
+void Benchmark::benchmarkFocal(int numQueries, int numLeaders, double weight) {
+  std::vector<query> queries = createQueries(numQueries);
+  AStar aStar(graph);
+  AStar::context ctx;
+
+  // The steps of a sampled path within the collision range of the leaders
+  auto countConflicts = [&](const ReservationIndex &index) {
+    Car car;
+    car.assignPath(ctx.path, graph);
+    const std::vector<sf::Vector2f> &samples = car.getPath();
+    int numConflicts = 0;
+    for (int i = 0; i < (int)samples.size(); i++) {
+      int bucket = ReservationIndex::getBucket(i * SIM_STEP_TIME);
+      numConflicts += index.hasBucket(bucket) && index.isBlocked(bucket, samples[i]);
+    }
+    return numConflicts;
+  };
+
+  double elapsed[2] = {0, 0};
+  long long expansions[2] = {0, 0};
+  long long conflicts[2] = {0, 0};
+  double costs[2] = {0, 0};
+  double maxBound = 1;
+  int numBoth = 0;
+  for (const auto &[start, end] : queries) {
+    std::vector<AStar::node> route = aStar.findPath(start, end);
+    int startId = graph.getPointId(start);
+    int endId = graph.getPointId(end);
+    if (route.empty() || startId < 0 || endId < 0)
+      continue;
+
+    // The leaders are the other cars of an ECBS low level: counted as conflicts, not forbidden
+    Car car;
+    car.assignPath(route, graph);
+    ReservationIndex index;
+    addLeaders(car.getPath(), numLeaders, &index);
+
+    TableHeuristic heuristic(graph.computeTravelTimes(endId, true));
+    double queryCosts[2] = {0, 0};
+    int queryConflicts[2] = {0, 0};
+    bool found[2] = {false, false};
+    for (int focal = 0; focal < 2; focal++) {
+      auto startTime = std::chrono::steady_clock::now();
+      if (focal) {
+        FocalKinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(),
+                                    ReservationConflicts(index), PointGoal(endId), IterationBudget(),
+                                    TimedPoseStateKey());
+        found[focal] = search.run(startId, weight) >= 0;
+      } else {
+        KinematicSearch search(graph, ctx, heuristic, TableSuccessors(graph), NoConstraint(), PointGoal(endId),
+                               IterationBudget(), TimedPoseStateKey());
+        found[focal] = search.run(startId) >= 0;
+      }
+      elapsed[focal] += secondsSince(startTime);
+      expansions[focal] += ctx.stats.numExpansions;
+      if (found[focal]) {
+        queryCosts[focal] = ctx.pathCost;
+        queryConflicts[focal] = countConflicts(index);
+        if (focal)
+          maxBound = std::max(maxBound, ctx.suboptimalityBound);
+      }
+    }
+
+    if (found[0] && found[1]) {
+      numBoth++;
+      for (int focal = 0; focal < 2; focal++) {
+        costs[focal] += queryCosts[focal];
+        conflicts[focal] += queryConflicts[focal];
+      }
+    }
+  }
+
+  spdlog::info("Optimal low level: {} queries ({} solved by both) in {:.3f}s, {} expansions, {} conflicting steps",
+               numQueries, numBoth, elapsed[0], expansions[0], conflicts[0]);
+  spdlog::info("Focal low level (w = {}): {:.3f}s, {} expansions, {} conflicting steps, cost {:+.2f}%, worst bound "
+               "{:.3f}",
+               weight, elapsed[1], expansions[1], conflicts[1], 100.0 * (costs[1] / std::max(costs[0], 1e-9) - 1),
+               maxBound);
+}
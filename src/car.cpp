@@ -6,9 +6,11 @@
  */
 #include "car.h"
 #include "config.h"
+#include "routePlanner.h"
 #include "utils.h"
 #include <SFML/Graphics/Text.hpp>
 #include <SFML/System/Angle.hpp>
+#include <random>
 #include <spdlog/spdlog.h>
 
 Car::Car() {
@@ -82,7 +84,7 @@ void Car::render(sf::RenderWindow &window) {
   }
 }
 
-void Car::assignPath(std::vector<AStar::node> path, CityGraph &graph) {
+void Car::assignPath(std::vector<AStar::node> path, const CityGraph &graph) {
   this->path.clear();
   this->aStarPath = path;
   currentPoint = 0;
@@ -102,6 +104,13 @@ void Car::assignPath(std::vector<AStar::node> path, CityGraph &graph) {
 
     double duration = interpolator->getDuration(prevNode.speed, node.speed);
 
+    // A safe interval path can stop at the start of an arc before taking it
+    while (t < prevTime + node.waitTime) {
+      this->path.push_back(start.position);
+      t += SIM_STEP_TIME;
+    }
+    prevTime += node.waitTime;
+
     while (t < prevTime + duration) {
       double tt = t - prevTime;
       CityGraph::point p = interpolator->get(tt, prevNode.speed, node.speed);
@@ -111,10 +120,12 @@ void Car::assignPath(std::vector<AStar::node> path, CityGraph &graph) {
     }
     prevTime += duration;
   }
+  pathDuration = prevTime;
 }
 
 void Car::assignExistingPath(std::vector<sf::Vector2f> path) {
   this->path = path;
+  pathDuration = getPathTime();
   currentPoint = 0;
 }
 
@@ -168,37 +179,17 @@ double Car::getPathLength() {
   return dist;
 }
 
-void Car::chooseRandomStartEndPath(CityGraph &graph, CityMap &cityMap) {
-  CityGraph::point start;
-  CityGraph::point end;
-
-  double minDistance = std::max(graph.getWidth(), graph.getHeight()) / 2.0;
-  std::vector<AStar::node> path;
-
-  do {
-    path.clear();
-    start = graph.getRandomPoint();
-    end = graph.getRandomPoint();
-
-    if (std::sqrt(std::pow(start.position.x - end.position.x, 2) + std::pow(start.position.y - end.position.y, 2)) <
-        minDistance)
-      continue;
-
-    AStar aStar(start, end, graph);
-    path = aStar.findPath();
-
-    if (!path.empty() && (int)path.size() >= 3) {
-      AStar aStar(start, end, graph);
-      path.clear();
-      path = aStar.findPath();
-    }
-  } while (path.empty() || (int)path.size() < 3);
+void Car::chooseRandomStartEndPath(const CityGraph &graph, const CityMap &cityMap) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  AStar aStar(graph);
+  RoutePlanner::route route = RoutePlanner::planRandomRoute(graph, aStar, gen);
 
-  this->assignStartEnd(start, end);
-  this->assignPath(path, graph);
+  this->assignStartEnd(route.start, route.end);
+  this->assignPath(route.path, graph);
 }
 
-double Car::getAverageSpeed(CityGraph &graph) {
+double Car::getAverageSpeed(const CityGraph &graph) {
   double dist = 0;
   double time = 0;
   auto outOfBounds = [&](sf::Vector2f p) {
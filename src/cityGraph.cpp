@@ -6,12 +6,18 @@
  * contains the points of the graph and the neighbors of each point.
  */
 #include "cityGraph.h"
+#include "dubins.h"
+#include "indexedHeap.h"
+#include "kinematicSearch.h"
 #include "utils.h"
 #include <ompl/base/State.h>
 #include <ompl/base/StateSpace.h>
 #include <ompl/base/spaces/DubinsStateSpace.h>
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/geometric/planners/rrt/RRT.h>
+#include <atomic>
+#include <limits>
+#include <map>
 #include <random>
 #include <spdlog/spdlog.h>
 
@@ -24,14 +30,20 @@ void CityGraph::createGraph(const CityMap &cityMap) {
   this->height = cityMap.getHeight();
   this->width = cityMap.getWidth();
 
+  // Every point is tagged with the road segment it was created for, the node of the coarse graph it belongs to
+  roadGraph.build(cityMap);
+  pointRegions.clear();
+
   // Graph's points are evenly distributed along a road segment
-  for (const auto &road : roads) {
+  for (int roadIndex = 0; roadIndex < (int)roads.size(); roadIndex++) {
+    const auto &road = roads[roadIndex];
     if (road.segments.empty()) {
       continue;
     }
 
     int numSeg = 0;
     for (const auto &segment : road.segments) {
+      int region = roadGraph.getNodeId(roadIndex, numSeg);
       if (numSeg > 0) { // Link to the previous one
         for (int i_lane = 0; i_lane < road.numLanes; i_lane++) {
           double offset = ((double)i_lane - (double)road.numLanes / 2.0f) * road.width / road.numLanes;
@@ -49,7 +61,7 @@ void CityGraph::createGraph(const CityMap &cityMap) {
               sf::Vector2f(road.segments[numSeg].p1_offset.x + offset * sin(road.segments[numSeg].angle.asRadians()),
                            road.segments[numSeg].p1_offset.y + offset * -cos(road.segments[numSeg].angle.asRadians()));
 
-          linkPoints(point1, point2, 2, true);
+          linkPoints(point1, point2, 2, true, roadGraph.getNodeId(roadIndex, numSeg - 1), region);
         }
       }
       numSeg++;
@@ -81,7 +93,7 @@ void CityGraph::createGraph(const CityMap &cityMap) {
           point2.angle = segment.angle;
           point2.position = sf::Vector2f(segment.p2_offset.x + offset * dx_a, segment.p2_offset.y + offset * dy_a);
 
-          linkPoints(point1, point2, 2, true);
+          linkPoints(point1, point2, 2, true, region, region);
           continue;
         }
 
@@ -109,10 +121,10 @@ void CityGraph::createGraph(const CityMap &cityMap) {
                 } else {
                   direction = offset > 0 ? 1 : 0;
                 }
-                linkPoints(point1, point2, direction, offset == offset2);
+                linkPoints(point1, point2, direction, offset == offset2, region, region);
               } else {
                 if (!ROAD_ENABLE_RIGHT_HAND_TRAFFIC) {
-                  linkPoints(point1, point2, 2, true);
+                  linkPoints(point1, point2, 2, true, region, region);
                 }
               }
             }
@@ -130,6 +142,8 @@ void CityGraph::createGraph(const CityMap &cityMap) {
         const auto &road2 = roads[roadSegmentId2.first];
         const auto &segment1 = road1.segments[roadSegmentId1.second];
         const auto &segment2 = road2.segments[roadSegmentId2.second];
+        int region1 = roadGraph.getNodeId(roadSegmentId1.first, roadSegmentId1.second);
+        int region2 = roadGraph.getNodeId(roadSegmentId2.first, roadSegmentId2.second);
 
         // Find the point of the segment2 closest to the intersection
         point point1;
@@ -162,7 +176,7 @@ void CityGraph::createGraph(const CityMap &cityMap) {
             point2_offset.position = sf::Vector2f(point2.position.x + offset2 * sin(segment2.angle.asRadians()),
                                                   point2.position.y + offset2 * -cos(segment2.angle.asRadians()));
 
-            linkPoints(point1_offset, point2_offset, 2, true);
+            linkPoints(point1_offset, point2_offset, 2, true, region1, region2);
           }
         }
       }
@@ -219,9 +233,104 @@ void CityGraph::createGraph(const CityMap &cityMap) {
   }
 
   spdlog::info("Curves interpolated");
+
+  buildIndex();
+  computeLandmarks();
 }
 
-void CityGraph::linkPoints(const point &p, const point &n, int direction, bool subPoints) {
+void CityGraph::buildIndex() {
+  pointIds.clear();
+  points.clear();
+  edges.clear();
+  edgeOffsets.clear();
+  reverseEdges.clear();
+  reverseEdgeOffsets.clear();
+  boundaryPoints.clear();
+  regions.clear();
+
+  static std::atomic<unsigned int> nextVersion{0};
+  version = ++nextVersion;
+
+  auto addPoint = [&](const point &p) {
+    auto it = pointIds.find(p);
+    if (it != pointIds.end())
+      return it->second;
+    int id = points.size();
+    pointIds.emplace(p, id);
+    points.push_back(p);
+    return id;
+  };
+
+  for (const auto &[p, pointNeighbors] : neighbors) {
+    addPoint(p);
+    for (const auto &n : pointNeighbors)
+      addPoint(n.point);
+  }
+  for (const auto &p : graphPoints)
+    addPoint(p);
+
+  // Group the edges by source point. Duplicated neighbors are merged, and edges without an interpolator (never
+  // filtered by the turning constraint) are left out since no car can follow them
+  std::vector<const std::vector<neighbor> *> neighborsById(points.size(), nullptr);
+  for (const auto &[p, pointNeighbors] : neighbors)
+    neighborsById[pointIds[p]] = &pointNeighbors;
+
+  edgeOffsets.reserve(points.size() + 1);
+  for (int id = 0; id < (int)points.size(); id++) {
+    edgeOffsets.push_back(edges.size());
+    if (neighborsById[id] == nullptr)
+      continue;
+
+    for (const auto &n : *neighborsById[id]) {
+      DubinsInterpolator *interpolator = getInterpolator(points[id], n);
+      if (interpolator == nullptr)
+        continue;
+
+      bool duplicate = false;
+      for (int e = edgeOffsets.back(); e < (int)edges.size() && !duplicate; e++)
+        duplicate = edges[e].neighbor == n;
+      if (duplicate)
+        continue;
+
+      edges.push_back({id, pointIds[n.point], n, interpolator->getDistance(), interpolator});
+    }
+  }
+  edgeOffsets.push_back(edges.size());
+
+  // Reverse adjacency: the same edges grouped by target point
+  reverseEdgeOffsets.assign(points.size() + 1, 0);
+  for (const auto &e : edges)
+    reverseEdgeOffsets[e.to + 1]++;
+  for (int id = 0; id < (int)points.size(); id++)
+    reverseEdgeOffsets[id + 1] += reverseEdgeOffsets[id];
+
+  reverseEdges.assign(edges.size(), -1);
+  std::vector<int> fill(reverseEdgeOffsets.begin(), reverseEdgeOffsets.end() - 1);
+  for (int e = 0; e < (int)edges.size(); e++)
+    reverseEdges[fill[edges[e].to]++] = e;
+
+  buildSpeedTransitions();
+
+  regions.assign(points.size(), -1);
+  for (const auto &[p, region] : pointRegions) {
+    auto it = pointIds.find(p);
+    if (it != pointIds.end())
+      regions[it->second] = region;
+  }
+  std::unordered_map<point, int>().swap(pointRegions);
+
+  // Random start and end points are drawn among the points outside the map
+  for (const auto &p : graphPoints) {
+    if (p.position.x + CAR_LENGTH < 0 || p.position.x - CAR_LENGTH > width || p.position.y + CAR_LENGTH < 0 ||
+        p.position.y - CAR_LENGTH > height)
+      boundaryPoints.push_back(p);
+  }
+
+  spdlog::info("Graph indexed with {} points and {} edges", points.size(), edges.size());
+}
+
+void CityGraph::linkPoints(const point &p, const point &n, int direction, bool subPoints, int region,
+                           int neighborRegion) {
   std::vector<sf::Angle> anglesPoint = {p.angle, p.angle + sf::radians(M_PI)};
   std::vector<sf::Angle> anglesNeighbor = {n.angle, n.angle + sf::radians(M_PI)};
 
@@ -246,6 +355,8 @@ void CityGraph::linkPoints(const point &p, const point &n, int direction, bool s
 
         graphPoints.insert(copyPoint);
         graphPoints.insert(copyNeighbor);
+        pointRegions.emplace(copyPoint, region);
+        pointRegions.emplace(copyNeighbor, neighborRegion);
       }
     }
     return;
@@ -262,6 +373,7 @@ void CityGraph::linkPoints(const point &p, const point &n, int direction, bool s
     for (const auto &angleNeighbor : anglesNeighbor) {
       point previousPoint = p;
       previousPoint.angle = anglePoint;
+      pointRegions.emplace(previousPoint, region);
 
       for (int i = 1; i <= numPoints; i++) {
         point newPoint;
@@ -274,30 +386,162 @@ void CityGraph::linkPoints(const point &p, const point &n, int direction, bool s
         previousPoint = newPoint;
 
         graphPoints.insert(newPoint);
+        pointRegions.emplace(newPoint, region);
       }
 
       // Add the last point
       neighbors[previousPoint].push_back({n, 0, 0, isRiP}); // This fields will be updated later
+      pointRegions.emplace(n, neighborRegion);
     }
   }
 }
 
-CityGraph::point CityGraph::getRandomPoint() const {
-  std::vector<point> graphPointsOut;
-  for (const auto &point : graphPoints) {
-    if (point.position.x + CAR_LENGTH < 0 || point.position.x - CAR_LENGTH > width ||
-        point.position.y + CAR_LENGTH < 0 || point.position.y - CAR_LENGTH > height)
-      graphPointsOut.push_back(point);
+void CityGraph::buildSpeedTransitions() {
+  transitionOffsets.clear();
+  transitionBuckets.clear();
+
+  // Tables by (reference length, maximum speed): offsets of the forward and the reverse table
+  std::map<std::pair<double, double>, std::pair<int, int>> tables;
+  KinematicSuccessors successors;
+
+  for (auto &e : edges) {
+    int lengthClass = (int)std::floor(e.distance / TRANSITION_LENGTH_RESOLUTION);
+    int maxBucket = (int)std::floor(std::min(e.neighbor.maxSpeed, CAR_MAX_SPEED_MS) / SPEED_RESOLUTION + 1e-9);
+    e.maxSpeedBucket = maxBucket;
+    if (maxBucket < 0)
+      continue;
+
+    // The shortest edge of the class is the reference. The edges shorter than the resolution keep their exact length:
+    // a reference of length 0 would forbid every speed change on them
+    double referenceDistance = lengthClass > 0 ? lengthClass * TRANSITION_LENGTH_RESOLUTION : e.distance;
+    auto [it, inserted] = tables.try_emplace({referenceDistance, e.neighbor.maxSpeed});
+    if (inserted) {
+      // Transitions of the reference, from each entry bucket. The exit speeds are rounded towards the entry speed, so
+      // the acceleration limits still hold
+      edge reference = e;
+      reference.distance = referenceDistance;
+      std::vector<std::vector<int>> forward(maxBucket + 1);
+      std::vector<std::vector<int>> reverse(maxBucket + 1);
+      for (int bucket = 0; bucket <= maxBucket; bucket++) {
+        double speed = bucket * SPEED_RESOLUTION;
+        successors(reference, speed, [&](double newSpeed, double) {
+          int newBucket = bucket;
+          if (newSpeed > speed)
+            newBucket = (int)std::floor(newSpeed / SPEED_RESOLUTION + 1e-9);
+          else if (newSpeed < speed)
+            newBucket = (int)std::ceil(newSpeed / SPEED_RESOLUTION - 1e-9);
+          if (newBucket > maxBucket)
+            return;
+          forward[bucket].push_back(newBucket);
+        });
+        std::sort(forward[bucket].begin(), forward[bucket].end());
+        forward[bucket].erase(std::unique(forward[bucket].begin(), forward[bucket].end()), forward[bucket].end());
+        for (int newBucket : forward[bucket])
+          reverse[newBucket].push_back(bucket);
+      }
+
+      auto append = [&](const std::vector<std::vector<int>> &table) {
+        int offset = transitionOffsets.size();
+        for (const auto &buckets : table) {
+          transitionOffsets.push_back(transitionBuckets.size());
+          transitionBuckets.insert(transitionBuckets.end(), buckets.begin(), buckets.end());
+        }
+        transitionOffsets.push_back(transitionBuckets.size());
+        return offset;
+      };
+      it->second.first = append(forward);
+      it->second.second = append(reverse);
+    }
+
+    e.transitions = it->second.first;
+    e.reverseTransitions = it->second.second;
+  }
+
+  spdlog::info("Speed transitions: {} tables ({} KB)", 2 * tables.size(),
+               (transitionOffsets.size() + transitionBuckets.size()) * sizeof(int) / 1024);
+}
+
+double CityGraph::getMinTravelTime(int edgeId) const {
+  const edge &e = edges[edgeId];
+  if (!e.neighbor.isRightWay && ROAD_ENABLE_RIGHT_HAND_TRAFFIC)
+    return std::numeric_limits<double>::infinity();
+  if (e.distance == 0)
+    return 0;
+
+  double maxSpeed = std::min(e.neighbor.maxSpeed, CAR_MAX_SPEED_MS);
+  if (maxSpeed <= 0)
+    return std::numeric_limits<double>::infinity();
+  return e.distance / maxSpeed;
+}
+
+std::vector<double> CityGraph::computeTravelTimes(int pointId, bool reverse) const {
+  std::vector<double> times(points.size(), std::numeric_limits<double>::infinity());
+  IndexedHeap<> openSet;
+  openSet.reserve(points.size());
+
+  times[pointId] = 0;
+  openSet.push(pointId, 0);
+  while (!openSet.empty()) {
+    int current = openSet.pop();
+    int first = reverse ? reverseEdgeOffsets[current] : edgeOffsets[current];
+    int last = reverse ? reverseEdgeOffsets[current + 1] : edgeOffsets[current + 1];
+    for (int position = first; position < last; position++) {
+      int edgeId = reverse ? reverseEdges[position] : position;
+      int next = reverse ? edges[edgeId].from : edges[edgeId].to;
+      double time = times[current] + getMinTravelTime(edgeId);
+      if (time < times[next]) {
+        times[next] = time;
+        openSet.push(next, time);
+      }
+    }
+  }
+
+  return times;
+}
+
+void CityGraph::computeLandmarks(int numLandmarks) {
+  this->numLandmarks = 0;
+  landmarkTimes.clear();
+  numLandmarks = std::min(numLandmarks, (int)points.size());
+  if (numLandmarks <= 0)
+    return;
+
+  landmarkTimes.assign(2 * numLandmarks * points.size(), 0);
+  this->numLandmarks = numLandmarks;
+
+  // Farthest-point selection, starting from the first boundary point (or point 0): the next landmark is the point
+  // reachable from every chosen landmark with the largest time from the nearest one
+  std::vector<double> minTimes(points.size(), std::numeric_limits<double>::infinity());
+  int landmark = boundaryPoints.empty() ? 0 : getPointId(boundaryPoints.front());
+  for (int i = 0; i < numLandmarks; i++) {
+    std::vector<double> from = computeTravelTimes(landmark, false);
+    std::vector<double> to = computeTravelTimes(landmark, true);
+    for (int id = 0; id < (int)points.size(); id++) {
+      landmarkTimes[2 * numLandmarks * id + 2 * i] = from[id];
+      landmarkTimes[2 * numLandmarks * id + 2 * i + 1] = to[id];
+      minTimes[id] = std::min(minTimes[id], std::isfinite(from[id]) ? from[id] : -1.0);
+    }
+
+    int next = -1;
+    for (int id = 0; id < (int)points.size(); id++) {
+      if (minTimes[id] > 0 && (next < 0 || minTimes[id] > minTimes[next]))
+        next = id;
+    }
+    landmark = next >= 0 ? next : (landmark + 1) % (int)points.size();
   }
 
-  auto it = graphPointsOut.begin();
+  spdlog::info("Computed {} landmarks ({} KB)", numLandmarks, landmarkTimes.size() * sizeof(double) / 1024);
+}
+
+CityGraph::point CityGraph::getRandomPoint() const {
   std::random_device rd;
   std::mt19937 gen(rd());
-  std::uniform_int_distribution<> dis(0, graphPointsOut.size() - 1);
-
-  std::advance(it, dis(gen));
+  return getRandomPoint(gen);
+}
 
-  return *it;
+CityGraph::point CityGraph::getRandomPoint(std::mt19937 &gen) const {
+  std::uniform_int_distribution<> dis(0, boundaryPoints.size() - 1);
+  return boundaryPoints[dis(gen)];
 }
 
 bool CityGraph::canLink(const point &point1, const point &point2, double speed, double *distance) const {
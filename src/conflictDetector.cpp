@@ -0,0 +1,316 @@
+/**
+ * @file conflictDetector.cpp
+ * @brief Detection of the conflicts between the sampled paths of the cars
+ *
+ * This file contains the implementation of the ConflictDetector class.
+ */
+#include "conflictDetector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+static int getMaxPathLength(const ConflictDetector::paths &paths) {
+  int maxPathLength = 0;
+  for (const auto &path : paths)
+    maxPathLength = std::max(maxPathLength, (int)path->size());
+  return maxPathLength;
+}
+
+bool ConflictDetector::findFirstConflict(const paths &paths, int *car1, int *car2, int *time) {
+  // A short horizon is a single slice, not worth waking the threads up
+  int maxPathLength = getMaxPathLength(paths);
+  if (pool && pool->getNumThreads() > 1 && maxPathLength > CONFLICT_SLICE_STEPS)
+    return findFirstConflictParallel(paths, *pool, car1, car2, time);
+  return scanSteps(paths, 0, maxPathLength, nullptr, car1, car2, time);
+}
+
+bool ConflictDetector::findFirstConflictSimd(const paths &paths, int *car1, int *car2, int *time) {
+  return scanSimd(paths, 0, getMaxPathLength(paths), nullptr, car1, car2, time);
+}
+
+bool ConflictDetector::findFirstConflictGrid(const paths &paths, int *car1, int *car2, int *time) {
+  return scanGrid(paths, 0, getMaxPathLength(paths), nullptr, car1, car2, time);
+}
+
+bool ConflictDetector::findFirstConflictParallel(const paths &paths, ThreadPool &pool, int *car1, int *car2,
+                                                 int *time) {
+  int maxPathLength = getMaxPathLength(paths);
+  int numSlices = (maxPathLength + CONFLICT_SLICE_STEPS - 1) / CONFLICT_SLICE_STEPS;
+  if ((int)sliceDetectors.size() < pool.getNumThreads())
+    sliceDetectors.resize(pool.getNumThreads(), ConflictDetector(range));
+  sliceConflicts.assign(3 * (std::size_t)numSlices, -1);
+
+  // The pool hands the slices out in order, so the earliest ones are scanned first and the later ones are mostly
+  // skipped once a conflict is found
+  std::atomic<int> earliest(std::numeric_limits<int>::max());
+  pool.parallelFor(numSlices, [&](int slice, int threadIndex) {
+    int firstStep = slice * CONFLICT_SLICE_STEPS;
+    if (firstStep >= earliest.load(std::memory_order_relaxed))
+      return;
+
+    int endStep = std::min(firstStep + CONFLICT_SLICE_STEPS, maxPathLength);
+    int *conflict = &sliceConflicts[3 * (std::size_t)slice];
+    if (!sliceDetectors[threadIndex].scanSteps(paths, firstStep, endStep, &earliest, &conflict[0], &conflict[1],
+                                               &conflict[2]))
+      return;
+
+    int current = earliest.load(std::memory_order_relaxed);
+    while (conflict[2] < current && !earliest.compare_exchange_weak(current, conflict[2], std::memory_order_relaxed)) {
+    }
+  });
+
+  // A slice stopped by the bound has no conflict before it, so the first slice with a conflict holds the first one
+  for (int slice = 0; slice < numSlices; slice++) {
+    const int *conflict = &sliceConflicts[3 * (std::size_t)slice];
+    if (conflict[2] >= 0) {
+      *car1 = conflict[0];
+      *car2 = conflict[1];
+      *time = conflict[2];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ConflictDetector::scanSteps(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound,
+                                 int *car1, int *car2, int *time) {
+  // Below the threshold, the SIMD pairwise check beats the cost of building the grid at every step
+  if ((int)paths.size() <= CONFLICT_SIMD_MAX_CARS)
+    return scanSimd(paths, firstStep, endStep, bound, car1, car2, time);
+  return scanGrid(paths, firstStep, endStep, bound, car1, car2, time);
+}
+
+bool ConflictDetector::scanSimd(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound,
+                                int *car1, int *car2, int *time) {
+  // The steps are copied by windows, so an early conflict does not pay for the whole horizon
+  for (int first = firstStep; first < endStep; first += CONFLICT_SIMD_WINDOW_STEPS) {
+    trajectories.assign(paths, first, std::min(CONFLICT_SIMD_WINDOW_STEPS, endStep - first));
+
+    int numCars = trajectories.getNumCars();
+    for (int t = trajectories.getFirstStep(); t < trajectories.getEndStep(); t++) {
+      if (bound && t >= bound->load(std::memory_order_relaxed))
+        return false;
+
+      const float *x = trajectories.getX(t);
+      const float *y = trajectories.getY(t);
+      for (int i = 0; i + 1 < numCars; i++) {
+        if (!trajectories.isActive(i, t))
+          continue;
+        // The arrived cars are parked far away, the kernel never matches them
+        int k = findFirstInRange(x + i + 1, y + i + 1, numCars - i - 1, x[i], y[i], range2);
+        if (k >= 0) {
+          *car1 = i;
+          *car2 = i + 1 + k;
+          *time = t;
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+bool ConflictDetector::scanGrid(const paths &paths, int firstStep, int endStep, const std::atomic<int> *bound,
+                                int *car1, int *car2, int *time) {
+  int numCars = paths.size();
+  for (int t = firstStep; t < endStep; t++) {
+    if (bound && t >= bound->load(std::memory_order_relaxed))
+      return false;
+
+    buildGrid(paths, t);
+    for (int i = 0; i < numCars; i++) {
+      if (carBuckets[i] < 0)
+        continue;
+
+      int firstOther = numCars;
+      forEachNeighbor(paths, i, t, [&](int j) {
+        if (j > i && j < firstOther && collide((*paths[i])[t], (*paths[j])[t]))
+          firstOther = j;
+      });
+      if (firstOther < numCars) {
+        *car1 = i;
+        *car2 = firstOther;
+        *time = t;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool ConflictDetector::findFirstConflictBruteForce(const paths &paths, int *car1, int *car2, int *time) const {
+  int numCars = paths.size();
+  int maxPathLength = getMaxPathLength(paths);
+
+  for (int t = 0; t < maxPathLength; t++) {
+    for (int i = 0; i < numCars; i++) {
+      if (t >= (int)paths[i]->size())
+        continue;
+      for (int j = i + 1; j < numCars; j++) {
+        if (t >= (int)paths[j]->size())
+          continue;
+        if (collide((*paths[i])[t], (*paths[j])[t])) {
+          *car1 = i;
+          *car2 = j;
+          *time = t;
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+void ConflictDetector::findConflicts(const paths &paths, std::vector<pair> *conflicts) {
+  int maxPathLength = getMaxPathLength(paths);
+  conflicts->clear();
+  if (pool && pool->getNumThreads() > 1 && maxPathLength > CONFLICT_SLICE_STEPS) {
+    int numSlices = (maxPathLength + CONFLICT_SLICE_STEPS - 1) / CONFLICT_SLICE_STEPS;
+    if ((int)sliceDetectors.size() < pool->getNumThreads())
+      sliceDetectors.resize(pool->getNumThreads(), ConflictDetector(range));
+    std::vector<std::vector<pair>> slicePairs(numSlices);
+    pool->parallelFor(numSlices, [&](int slice, int threadIndex) {
+      int firstStep = slice * CONFLICT_SLICE_STEPS;
+      int endStep = std::min(firstStep + CONFLICT_SLICE_STEPS, maxPathLength);
+      sliceDetectors[threadIndex].collectConflicts(paths, firstStep, endStep, &slicePairs[slice]);
+    });
+    for (const auto &pairs : slicePairs)
+      conflicts->insert(conflicts->end(), pairs.begin(), pairs.end());
+  } else {
+    collectConflicts(paths, 0, maxPathLength, conflicts);
+  }
+
+  // A pair can be found by several slices: keep its earliest step
+  std::sort(conflicts->begin(), conflicts->end(), [](const pair &a, const pair &b) {
+    return a.car1 < b.car1 || (a.car1 == b.car1 && (a.car2 < b.car2 || (a.car2 == b.car2 && a.time < b.time)));
+  });
+  conflicts->erase(std::unique(conflicts->begin(), conflicts->end(),
+                               [](const pair &a, const pair &b) { return a.car1 == b.car1 && a.car2 == b.car2; }),
+                   conflicts->end());
+  std::sort(conflicts->begin(), conflicts->end());
+}
+
+void ConflictDetector::collectConflicts(const paths &paths, int firstStep, int endStep, std::vector<pair> *conflicts) {
+  int numCars = paths.size();
+
+  // The steps are scanned in order, so the first step recorded for a pair is its first conflict
+  std::unordered_map<long long, int> firstSteps;
+  for (int t = firstStep; t < endStep; t++) {
+    buildGrid(paths, t);
+    for (int i = 0; i < numCars; i++) {
+      if (carBuckets[i] < 0)
+        continue;
+      forEachNeighbor(paths, i, t, [&](int j) {
+        if (j > i && collide((*paths[i])[t], (*paths[j])[t]))
+          firstSteps.emplace((long long)i * numCars + j, t);
+      });
+    }
+  }
+
+  for (const auto &[key, t] : firstSteps)
+    conflicts->push_back({(int)(key / numCars), (int)(key % numCars), t});
+}
+
+void ConflictDetector::updateConflicts(const paths &paths, int car, std::vector<pair> *conflicts) const {
+  conflicts->erase(std::remove_if(conflicts->begin(), conflicts->end(),
+                                  [car](const pair &p) { return p.car1 == car || p.car2 == car; }),
+                   conflicts->end());
+
+  std::size_t numKept = conflicts->size();
+  const std::vector<sf::Vector2f> &path = *paths[car];
+  for (int other = 0; other < (int)paths.size(); other++) {
+    if (other == car)
+      continue;
+    int length = std::min(path.size(), paths[other]->size());
+    for (int t = 0; t < length; t++) {
+      if (collide(path[t], (*paths[other])[t])) {
+        conflicts->push_back({std::min(car, other), std::max(car, other), t});
+        break;
+      }
+    }
+  }
+
+  std::sort(conflicts->begin() + numKept, conflicts->end());
+  std::inplace_merge(conflicts->begin(), conflicts->begin() + numKept, conflicts->end());
+}
+
+int ConflictDetector::countConflictingPairs(const paths &paths) {
+  int numCars = paths.size();
+  int maxPathLength = getMaxPathLength(paths);
+
+  std::unordered_set<long long> pairs;
+  for (int t = 0; t < maxPathLength; t++) {
+    buildGrid(paths, t);
+    for (int i = 0; i < numCars; i++) {
+      if (carBuckets[i] < 0)
+        continue;
+      forEachNeighbor(paths, i, t, [&](int j) {
+        if (j > i && collide((*paths[i])[t], (*paths[j])[t]))
+          pairs.insert((long long)i * numCars + j);
+      });
+    }
+  }
+
+  return pairs.size();
+}
+
+void ConflictDetector::getCell(const sf::Vector2f &position, long long *x, long long *y) const {
+  *x = (long long)std::floor(position.x / range);
+  *y = (long long)std::floor(position.y / range);
+}
+
+int ConflictDetector::getBucket(long long x, long long y) const {
+  std::uint64_t h = (std::uint64_t)x * 0x9E3779B97F4A7C15ULL ^ (std::uint64_t)y * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 32;
+  return (int)(h & (bucketOffsets.size() - 2));
+}
+
+void ConflictDetector::buildGrid(const paths &paths, int time) {
+  int numCars = paths.size();
+
+  // A power of two of at least twice the number of cars, plus the end offset
+  std::size_t numBuckets = 1;
+  while (numBuckets < 2 * (std::size_t)std::max(numCars, 1))
+    numBuckets *= 2;
+  bucketOffsets.assign(numBuckets + 1, 0);
+  carBuckets.assign(numCars, -1);
+
+  for (int i = 0; i < numCars; i++) {
+    if (time >= (int)paths[i]->size())
+      continue;
+    long long x, y;
+    getCell((*paths[i])[time], &x, &y);
+    carBuckets[i] = getBucket(x, y);
+    bucketOffsets[carBuckets[i] + 1]++;
+  }
+  for (std::size_t b = 0; b < numBuckets; b++)
+    bucketOffsets[b + 1] += bucketOffsets[b];
+
+  bucketCars.resize(bucketOffsets.back());
+  std::vector<int> &fill = fillBuffer;
+  fill.assign(bucketOffsets.begin(), bucketOffsets.end() - 1);
+  for (int i = 0; i < numCars; i++) {
+    if (carBuckets[i] >= 0)
+      bucketCars[fill[carBuckets[i]]++] = i;
+  }
+}
+
+template <typename Visit>
+void ConflictDetector::forEachNeighbor(const paths &paths, int car, int time, Visit &&visit) const {
+  long long x, y;
+  getCell((*paths[car])[time], &x, &y);
+  for (long long dx = -1; dx <= 1; dx++) {
+    for (long long dy = -1; dy <= 1; dy++) {
+      int bucket = getBucket(x + dx, y + dy);
+      for (int k = bucketOffsets[bucket]; k < bucketOffsets[bucket + 1]; k++)
+        visit(bucketCars[k]);
+    }
+  }
+}
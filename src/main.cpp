@@ -4,6 +4,7 @@
  *
  * This file contains the main function of the project. It is used to run the simulation and create data.
  */
+#include "benchmark.h"
 #include "cityMap.h"
 #include "config.h"
 #include "dataManager.h"
@@ -23,22 +24,27 @@ int main(int nArgs, char **args) {
   spdlog::set_pattern("[%d-%m-%C %H:%M:%S.%e] [%^%l%$] [thread %t] %v");
 
   if (nArgs < 1) {
-    spdlog::error("Usage: {} \"data\" [numCarsMin] [numCarsMax] [numData] || {} \"run\" [numCars]", args[0]);
+    spdlog::error("Usage: {} \"data\" [numCarsMin] [numCarsMax] [numData] || {} \"run\" [numCars] || {} \"bench\" "
+                  "[numQueries]",
+                  args[0], args[0], args[0]);
     return 1;
   }
 
   // Parse command line arguments
   bool data = args[1] == std::string("data");
+  bool bench = args[1] == std::string("bench");
   
   // Default values for simulation parameters
   int runNumCars = 10;
   int dataNumCarsMin = 10;
   int dataNumCarsMax = 15;
   int dataNumData = -1;
+  int benchNumQueries = BENCHMARK_NUM_QUERIES;
 
   if (nArgs > 2) {
     runNumCars = std::stoi(args[2]);
     dataNumCarsMin = std::stoi(args[2]);
+    benchNumQueries = std::stoi(args[2]);
   }
   if (nArgs > 3) {
     dataNumCarsMax = std::stoi(args[3]);
@@ -61,13 +67,24 @@ int main(int nArgs, char **args) {
     spdlog::set_level(spdlog::level::info);
   }
 
-  // Execute the appropriate mode: data generation or simulation
+  // Execute the appropriate mode: data generation, benchmarks or simulation
   if (data) {
     spdlog::info("Creating data for map {}, numData: {}, numCarsMin: {}, numCarsMax: {}", mapFile, dataNumData,
                  dataNumCarsMin, dataNumCarsMax);
 
     DataManager dataManager(mapFile);
     dataManager.createData(dataNumData, dataNumCarsMin, dataNumCarsMax, mapFile);
+  } else if (bench) {
+    spdlog::info("Running benchmarks for map {}, numQueries: {}", mapFile, benchNumQueries);
+
+    CityMap cityMap;
+    cityMap.loadFile("assets/map/" + mapFile);
+
+    CityGraph cityGraph;
+    cityGraph.createGraph(cityMap);
+
+    Benchmark benchmark(cityGraph);
+    benchmark.run(benchNumQueries);
   } else {
     spdlog::info("Running simulation for map {}, numCars: {}", mapFile, runNumCars);
 
@@ -77,7 +94,7 @@ int main(int nArgs, char **args) {
     CityGraph cityGraph;
     cityGraph.createGraph(cityMap);
 
-    ManagerCBS manager(cityGraph, cityMap);
+    ManagerOCBS manager(cityGraph, cityMap);
     manager.initializeAgents(runNumCars);
 
     Renderer renderer;
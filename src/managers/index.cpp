@@ -6,6 +6,7 @@
  * common functionality for all pathfinding managers (CBS, OCBS, etc.).
  */
 #include "manager.h"
+#include <cstdlib>
 
 void Manager::initializeAgents(int numCars) {
   spdlog::info("Initializing {} agent(s)...", numCars);
@@ -21,9 +22,20 @@ void Manager::initializeAgents(int numCars) {
     cars.push_back(car);
   }
 
-  // Assign random start and end positions for each car
+  // Plan the random start and end positions of all cars on the planner threads. The seed is logged so that a run can
+  // be reproduced
+  unsigned int seed = rand();
+  spdlog::info("Planning routes on {} thread(s) with seed {}", planner.getNumThreads(), seed);
+  planner.resetStats();
+  std::vector<RoutePlanner::route> routes = planner.planRandomRoutes(numCars, seed);
+  spdlog::info("Route cache: {} hit(s), {} miss(es)", planner.getCache().getNumHits(),
+               planner.getCache().getNumMisses());
+  spdlog::info("Route searches: {}", planner.getStats().toJson());
+
+  // Assign the routes in car order
   for (int i = 0; i < numCars; i++) {
-    cars[i].chooseRandomStartEndPath(graph, map);
+    cars[i].assignStartEnd(routes[i].start, routes[i].end);
+    cars[i].assignPath(routes[i].path, graph);
   }
 
   spdlog::info("Successfully initialized {} agent(s)", cars.size());
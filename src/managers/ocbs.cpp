@@ -2,19 +2,47 @@
  * @file managers/ocbs.cpp
  * @brief Optimal Conflict-Based Search (OCBS) implementation
  * 
- * This file contains the OCBS algorithm for multi-agent pathfinding. The pathfinding
- * method includes conflict checking, which differs from the basic A* in aStar.cpp.
- * 
- * @note The A* core logic is similar to aStar.cpp but includes additional conflict
- * checking for multi-agent coordination. This is intentional to keep conflict-aware
- * and conflict-free pathfinding separate.
+ * This file contains the OCBS algorithm for multi-agent pathfinding. The low-level pathfinding
+ * runs the search of kinematicSearch.h, shared with aStar.cpp, with a conflict checking policy, or the safe interval
+ * search of safeIntervalSearch.h.
  */
 #include "aStar.h"
 #include "config.h"
 #include "dubins.h"
+#include "kinematicSearch.h"
 #include "manager_ocbs.h"
+#include "safeIntervalSearch.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include <spdlog/spdlog.h>
 
+static const char *terminationName(ManagerOCBS::Termination termination) {
+  switch (termination) {
+  case ManagerOCBS::Termination::Solved:
+    return "solved";
+  case ManagerOCBS::Termination::NoSolution:
+    return "no solution";
+  case ManagerOCBS::Termination::TimeBudget:
+    return "time budget";
+  case ManagerOCBS::Termination::NodeBudget:
+    return "node budget";
+  case ManagerOCBS::Termination::MemoryBudget:
+    return "memory budget";
+  }
+  return "unknown";
+}
+
+// Memory held by a constraint tree node. A path shared by several nodes is split between its current holders
+static std::size_t getMemoryUsage(const ManagerOCBS::Node &node) {
+  std::size_t bytes = sizeof(node) + node.paths.capacity() * sizeof(node.paths[0]) +
+                      (node.costs.capacity() + node.lowerBounds.capacity()) * sizeof(double) +
+                      node.conflictPairs.capacity() * sizeof(ConflictDetector::pair);
+  for (const auto &path : node.paths)
+    bytes += path->capacity() * sizeof(sf::Vector2f) / std::max(path.use_count(), 1L);
+  return bytes;
+}
+
 void ManagerOCBS::userInput(sf::Event event, sf::RenderWindow &window) {
   // If left mouse click over a car, toggle debug for that car
   if (event.is<sf::Event::MouseButtonPressed>() &&
@@ -33,34 +61,63 @@ void ManagerOCBS::userInput(sf::Event event, sf::RenderWindow &window) {
 }
 
 void ManagerOCBS::planPaths() {
-  openSet = std::priority_queue<Node>();
+  openSet.clear(suboptimality);
   starts.clear();
   starts.resize(numCars);
   ends.clear();
   ends.resize(numCars);
-  baseCosts.clear();
-  baseCosts.resize(numCars);
 
   Node node;
   node.paths.resize(numCars);
   node.costs.resize(numCars);
   node.cost = 0;
+  node.lowerBounds.resize(numCars);
   node.depth = 0;
   node.hasResolved = false;
-  conflicts.clear();
+  node.constraints = -1;
+  node.memoryUsage = 0;
+  constraints.reset();
 
   for (int i = 0; i < numCars; i++) {
-    node.paths[i] = cars[i].getPath();
-    node.costs[i] = cars[i].getPathTime();
+    node.paths[i] = std::make_shared<const std::vector<sf::Vector2f>>(cars[i].getPath());
+    // The costs are the durations of the searches, not of the sampled paths, like the lower bounds of the low level
+    node.costs[i] = cars[i].getPathDuration();
     node.cost += node.costs[i];
-    baseCosts[i] = node.costs[i];
+    // The unconstrained paths are optimal: no constrained path can be cheaper
+    node.lowerBounds[i] = node.costs[i];
     starts[i] = cars[i].getStart();
     ends[i] = cars[i].getEnd();
   }
+  // The only full scan of the solve: the children inherit the pairs and only recheck their replanned car
+  conflictDetector.findConflicts(node.paths, &node.conflictPairs);
+  node.lowerBound = node.cost;
+
+  goalTimes.clear();
+  goalTimes.resize(numCars);
+  searchStats = AStar::stats();
+
+  pushNode(std::move(node));
+  spdlog::info("Starting to find paths using CBS (suboptimality factor {})", suboptimality);
+  lastResult = findPaths();
+  spdlog::info("CBS stopped ({}) after {} node(s) in {:.3f}s: {} conflicting pair(s), cost {}, lower bound {}, "
+               "suboptimality bound {:.3f}",
+               terminationName(lastResult.termination), lastResult.numExpansions, lastResult.elapsed,
+               lastResult.numConflicts, lastResult.cost, lastResult.lowerBound, lastResult.suboptimalityBound);
+  spdlog::info("CBS low-level searches: {}", searchStats.toJson());
+
+  // The goal tables and the constraints are only valid for this solve
+  std::vector<std::vector<double>>().swap(goalTimes);
+  constraints.release();
+  constraintIndex.release();
+  pathIndex.release();
+  openSet.clear(suboptimality);
+}
 
-  openSet.push(node);
-  spdlog::info("Starting to find paths using CBS");
-  findPaths();
+void ManagerOCBS::pushNode(Node node) {
+  double lowerBound = node.lowerBound;
+  double cost = node.cost;
+  int numConflicts = node.conflictPairs.size();
+  openSet.push(std::move(node), lowerBound, cost, numConflicts);
 }
 
 void ManagerOCBS::initializePaths(Node *node) {
@@ -71,278 +128,210 @@ void ManagerOCBS::initializePaths(Node *node) {
 }
 
 bool ManagerOCBS::findConflict(int *car1, int *car2, int *time, Node *node) {
-  int maxPathLength = -1;
-  for (int i = 0; i < numCars; i++) {
-    maxPathLength = std::max(maxPathLength, (int)node->paths[i].size());
-  }
-
-  for (int t = 0; t < maxPathLength; t++) {
-    for (int i = 0; i < numCars; i++) {
-      for (int j = i + 1; j < numCars; j++) {
-        sf::Vector2f diff = node->paths[i][t] - node->paths[j][t];
-        double len = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-        if (len < CAR_LENGTH * COLLISION_SAFETY_FACTOR) {
-          *car1 = i;
-          *car2 = j;
-          *time = t;
-          return true;
-        }
-      }
-    }
-  }
-
-  return false;
+  // The pairs are kept sorted like the scan of ConflictDetector::findFirstConflict
+  if (node->conflictPairs.empty())
+    return false;
+  *car1 = node->conflictPairs.front().car1;
+  *car2 = node->conflictPairs.front().car2;
+  *time = node->conflictPairs.front().time;
+  return true;
 }
 
-bool ManagerOCBS::findPaths() {
-  if (openSet.empty()) {
-    spdlog::info("No solution found");
-    return false;
-  }
+int ManagerOCBS::countConflicts(const Node &node) { return node.conflictPairs.size(); }
 
-  Node node = openSet.top();
-  openSet.pop();
+ManagerOCBS::Result ManagerOCBS::findPaths() {
+  auto startTime = std::chrono::steady_clock::now();
+  auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count(); };
 
-  spdlog::debug("Processing node with cost: {}", node.cost);
+  Result result;
+  result.termination = Termination::NoSolution;
+  double droppedLowerBound = std::numeric_limits<double>::infinity();
 
-  int car1, car2, time;
-  if (!findConflict(&car1, &car2, &time, &node)) {
-    spdlog::info("Found solution with cost: {}", node.cost);
+  // Best solution so far, to return when a budget runs out: fewest conflicting pairs, then lowest cost
+  Node best;
+  int bestConflicts = std::numeric_limits<int>::max();
+  std::size_t openSetMemory = 0;
+  const double maxMemory = CBS_MAX_OPENSET_SIZE * 1024 * 1024 * 1024;
 
-    for (int i = 0; i < numCars; i++) {
-      cars[i].assignExistingPath(node.paths[i]);
+  while (!openSet.empty()) {
+    if (elapsed() >= CBS_MAX_SUB_TIME) {
+      result.termination = Termination::TimeBudget;
+      break;
+    }
+    if (result.numExpansions >= CBS_MAX_NODES) {
+      result.termination = Termination::NodeBudget;
+      break;
+    }
+    if (openSetMemory + constraints.getMemoryUsage() >= maxMemory) {
+      result.termination = Termination::MemoryBudget;
+      break;
     }
 
-    return true;
-  }
-
-  spdlog::debug("Found conflict between car {} and car {} at time {}", car1, car2, time);
+    // Every solution below the open nodes and the dropped branches costs at least their smallest lower bound
+    double lowerBound = std::min(openSet.getLowerBound(), droppedLowerBound);
+    Node node = openSet.pop();
+    openSetMemory -= node.memoryUsage;
+    result.numExpansions++;
+
+    spdlog::debug("Processing node with cost: {}", node.cost);
+
+    int car1, car2, time;
+    if (!findConflict(&car1, &car2, &time, &node)) {
+      result.termination = Termination::Solved;
+      result.lowerBound = lowerBound;
+      best = std::move(node);
+      bestConflicts = 0;
+      break;
+    }
 
-  // Witch car is the most affected
-  int car1Index = car1;
-  int car2Index = car2;
+    int numConflicts = countConflicts(node);
+    if (numConflicts < bestConflicts || (numConflicts == bestConflicts && node.cost < best.cost)) {
+      best = node;
+      bestConflicts = numConflicts;
+    }
 
-  double ratio1 = node.costs[car1] / baseCosts[car1];
-  double ratio2 = node.costs[car2] / baseCosts[car2];
+    spdlog::debug("Found conflict between car {} and car {} at time {}", car1, car2, time);
+
+    // One child per car of the conflict, each keeping its car away from the position of the other car. A child whose
+    // car can not be replanned is a dead end, the other branch may still lead to a solution
+    for (int side = 0; side < 2; side++) {
+      int carIndex = side == 0 ? car1 : car2;
+      int otherIndex = side == 0 ? car2 : car1;
+      Node child = side == 0 ? node : std::move(node);
+      child.depth++;
+      child.constraints = addConstraint(child.constraints, carIndex, time * SIM_STEP_TIME,
+                                        (*child.paths[otherIndex])[time]);
+      if (!pathfinding(&child, carIndex)) {
+        // A replan cut by its budget does not prove the branch empty: its solutions still cost at least the bound of
+        // the parent
+        if (searchContext.stats.numExpansions >= ASTAR_MAX_ITERATIONS)
+          droppedLowerBound = std::min(droppedLowerBound, child.lowerBound);
+        continue;
+      }
 
-  if (ratio1 > ratio2) {
-    car1Index = car2;
-    car2Index = car1;
+      // The share of the paths changes while the node waits, so the bytes counted now are the ones given back at pop
+      child.memoryUsage = getMemoryUsage(child);
+      openSetMemory += child.memoryUsage;
+      pushNode(std::move(child));
+    }
   }
 
-  ConflictSituation situation1;
-  situation1.car = car1Index;
-  situation1.time = time * SIM_STEP_TIME;
-  situation1.at = node.paths[car1Index][time];
-  ConflictSituation situation2;
-  situation2.car = car1Index;
-  situation2.time = time * SIM_STEP_TIME;
-  situation2.at = node.paths[car2Index][time];
-
-  Conflict conflict1;
-  conflict1.car = car1Index;
-  conflict1.withCar = car2Index;
-  conflict1.time = time * SIM_STEP_TIME;
-  conflict1.position = node.paths[car1Index][time];
-
-  Conflict conflict2;
-  conflict2.car = car2Index;
-  conflict2.withCar = car1Index;
-  conflict2.time = time * SIM_STEP_TIME;
-  conflict2.position = node.paths[car2Index][time];
-
-  if (conflicts.find(situation1) == conflicts.end()) {
-    conflicts[situation1] = new std::unordered_set<Conflict>();
+  result.elapsed = elapsed();
+  if (result.termination != Termination::Solved)
+    result.lowerBound = std::min(openSet.getLowerBound(), droppedLowerBound);
+  if (bestConflicts == std::numeric_limits<int>::max()) {
+    spdlog::info("No solution found");
+    return result;
   }
-  conflicts[situation1]->insert(conflict1);
 
-  if (conflicts.find(situation2) == conflicts.end()) {
-    conflicts[situation2] = new std::unordered_set<Conflict>();
-  }
-  conflicts[situation2]->insert(conflict2);
+  if (result.termination == Termination::Solved)
+    spdlog::info("Found solution with cost: {}", best.cost);
+  else
+    spdlog::warn("CBS stopped before a conflict-free solution, keeping the best one ({} conflicting pair(s))",
+                 bestConflicts);
 
-  openSet.push(node);
+  for (int i = 0; i < numCars; i++) {
+    cars[i].assignExistingPath(*best.paths[i]);
+  }
 
-  pathfinding(&node, car1Index);
-  return findPaths();
+  result.numConflicts = bestConflicts;
+  result.cost = best.cost;
+  if (std::isfinite(result.lowerBound) && result.lowerBound > 0)
+    result.suboptimalityBound = std::max(1.0, best.cost / result.lowerBound);
+  return result;
 }
 
-void ManagerOCBS::pathfinding(Node *node, int carIndex) {
-  AStar::node start;
-  start.point = starts[carIndex];
-  start.speed = 0;
-  AStar::node end;
-  end.point = ends[carIndex];
-  end.speed = 0;
-
-  std::unordered_map<AStar::node, AStar::node> cameFrom;
-  std::unordered_map<AStar::node, double> gScore;
-  std::unordered_map<AStar::node, double> fScore;
-
-  auto heuristic = [&](const AStar::node &a) {
-    sf::Vector2f diff = end.point.position - a.point.position;
-    double distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-    return distance / CAR_MAX_SPEED_MS;
-  };
-  auto compare = [&](const AStar::node &a, const AStar::node &b) { return fScore[a] > fScore[b]; };
-
-  std::priority_queue<AStar::node, std::vector<AStar::node>, decltype(compare)> openSetAstar(compare);
-  std::unordered_set<AStar::node> isInOpenSet;
-
-  openSetAstar.push(start);
-  gScore[start] = 0;
-  fScore[start] = heuristic(start);
-
-  auto neighbors = graph.getNeighbors();
-
-  int nbIterations = 0;
-  while (!openSetAstar.empty() && nbIterations++ < ASTAR_MAX_ITERATIONS) {
-    AStar::node current = openSetAstar.top();
-    openSetAstar.pop();
-    isInOpenSet.erase(current);
-
-    if (current.point == end.point) {
-      AStar::node currentCopy = current;
-      std::vector<AStar::node> nodePaths;
-
-      while (!(currentCopy == start)) {
-        nodePaths.push_back(currentCopy);
-        currentCopy = cameFrom[currentCopy];
-      }
-
-      nodePaths.push_back(currentCopy);
-      std::reverse(nodePaths.begin(), nodePaths.end());
-
-      double oldCost = node->costs[carIndex];
-      cars[carIndex].assignPath(nodePaths, graph);
-
-      node->paths[carIndex] = cars[carIndex].getPath();
-      node->costs[carIndex] = cars[carIndex].getPathTime();
-      node->cost += node->costs[carIndex] - oldCost;
-
-      spdlog::debug("Found path for car {} with cost: {}", carIndex, node->costs[carIndex]);
-      return;
-    }
-
-    for (const auto &neighborGraphPoint : neighbors[current.point]) {
-      if (current.speed > neighborGraphPoint.maxSpeed)
-        continue;
+int ManagerOCBS::addConstraint(int parent, int car, double time, const sf::Vector2f &position) {
+  int index = constraints.allocate();
+  constraints[index] = {car, time, position, parent};
+  return index;
+}
 
-      if (!neighborGraphPoint.isRightWay && ROAD_ENABLE_RIGHT_HAND_TRAFFIC)
-        continue;
+void ManagerOCBS::buildConstraintIndex(const Node &node, int carIndex) {
+  constraintIndex.clear();
+  for (int c = node.constraints; c >= 0; c = constraints[c].parent) {
+    const Constraint &constraint = constraints[c];
+    if (constraint.car == carIndex)
+      constraintIndex.add(constraint.time, constraint.position);
+  }
+  constraintIndex.build();
+}
 
-      std::vector<double> newSpeeds;
-      newSpeeds.push_back(current.speed);
-
-      double distance = graph.getInterpolator(current.point, neighborGraphPoint)->getDistance();
-      double nSpeedAcc = std::sqrt(std::pow(current.speed, 2) + 2 * CAR_ACCELERATION * distance);
-      double nSpeedDec = std::sqrt(std::pow(current.speed, 2) - 2 * CAR_DECELERATION * distance);
-
-      auto push = [&](double nSpeed) {
-        int numSpeedDiv = NUM_SPEED_DIVISIONS;
-        for (int i = 1; i < numSpeedDiv + 1; i++) {
-          double s = (current.speed + (nSpeed - current.speed) * i / numSpeedDiv);
-          if (s < SPEED_RESOLUTION)
-            continue;
-          newSpeeds.push_back(s);
-        }
-      };
-
-      if (nSpeedAcc > neighborGraphPoint.maxSpeed && current.speed < neighborGraphPoint.maxSpeed) {
-        push(neighborGraphPoint.maxSpeed);
-      } else if (nSpeedAcc < neighborGraphPoint.maxSpeed) {
-        push(nSpeedAcc);
-      }
+void ManagerOCBS::buildPathIndex(const Node &node, int carIndex) {
+  // One position per car and time bucket: the conflict count only guides the focal search
+  const int stride = std::max(1, (int)std::round(OCBS_CONFLICT_RANGE / SIM_STEP_TIME));
+  pathIndex.clear();
+  for (int i = 0; i < numCars; i++) {
+    if (i == carIndex)
+      continue;
+    const std::vector<sf::Vector2f> &path = *node.paths[i];
+    for (int step = 0; step < (int)path.size(); step += stride)
+      pathIndex.add(step * SIM_STEP_TIME, path[step]);
+  }
+  pathIndex.build();
+}
 
-      if (nSpeedDec == nSpeedDec && std::isfinite(nSpeedDec)) { // check if nSpeedDec is finite and not NaN
-        if (nSpeedDec < 0 && current.speed > 0) {
-          push(0);
-        } else if (nSpeedDec >= 0) {
-          push(nSpeedDec);
-        }
-      }
+const std::vector<double> &ManagerOCBS::getGoalTimes(int carIndex, int endId) {
+  std::vector<double> &times = goalTimes[carIndex];
+  if (times.empty())
+    times = graph.computeTravelTimes(endId, true);
+  return times;
+}
 
-      AStar::node neighbor;
-      neighbor.point = neighborGraphPoint.point;
-      neighbor.arcFrom = {current.point, neighborGraphPoint};
-      if (distance == 0) {
-        neighbor.speed = current.speed;
-        if (gScore.find(neighbor) == gScore.end() || gScore[current] < gScore[neighbor]) {
-          cameFrom[neighbor] = current;
-          gScore[neighbor] = gScore[current];
-          fScore[neighbor] = gScore[neighbor] + heuristic(neighbor);
-
-          if (isInOpenSet.find(neighbor) == isInOpenSet.end()) {
-            openSetAstar.push(neighbor);
-            isInOpenSet.insert(neighbor);
-          }
-        }
-        continue;
-      }
+bool ManagerOCBS::pathfinding(Node *node, int carIndex) {
+  int endId = graph.getPointId(ends[carIndex]);
+  int startId = graph.getPointId(starts[carIndex]);
+  if (startId < 0 || endId < 0) {
+    spdlog::warn("A* failed to find a path for car {}: start or end is not in the graph", carIndex);
+    return false;
+  }
 
-      for (const auto &newSpeed : newSpeeds) {
-        if (newSpeed > CAR_MAX_SPEED_MS || newSpeed > neighborGraphPoint.maxSpeed || newSpeed < 0)
-          continue;
-
-        if (newSpeed == current.speed && newSpeed == 0)
-          continue;
-
-        neighbor.speed = newSpeed;
-
-        double duration = 2 * distance / (current.speed + newSpeed);
-        double tentativeGScore = gScore[current] + duration;
-
-        double t = gScore[current];
-        bool conflictFree = true;
-
-        // Checking for conflicts
-        DubinsInterpolator *interpolator = graph.getInterpolator(current.point, neighborGraphPoint);
-        for (double tt = 0; tt < duration; tt = tt + SIM_STEP_TIME) {
-          ConflictSituation confS;
-          confS.car = carIndex;
-          confS.at = interpolator->get(tt, current.speed, newSpeed).position;
-          confS.time = t + tt;
-
-          if (conflicts.find(confS) == conflicts.end()) {
-            continue;
-          }
-
-          std::unordered_set<Conflict> *conflictSet = conflicts[confS];
-
-          if (conflictSet->size() == 0) {
-            continue;
-          }
-
-          for (const auto &conf : *conflictSet) {
-            // Check during all the duration if there is a conflict
-            sf::Vector2f diff = confS.at - conf.position;
-            double len = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-
-            if (len < CAR_LENGTH * COLLISION_SAFETY_FACTOR) {
-              conflictFree = false;
-              break;
-            }
-          }
-          if (!conflictFree)
-            break;
-        }
-
-        if (!conflictFree)
-          continue;
-
-        if (gScore.find(neighbor) == gScore.end() || tentativeGScore < gScore[neighbor]) {
-          cameFrom[neighbor] = current;
-          gScore[neighbor] = tentativeGScore;
-          fScore[neighbor] = gScore[neighbor] + heuristic(neighbor);
-
-          if (isInOpenSet.find(neighbor) == isInOpenSet.end()) {
-            openSetAstar.push(neighbor);
-            isInOpenSet.insert(neighbor);
-          }
-        }
-      }
-    }
+  // The same car is replanned toward the same goal many times: its backward travel times are computed once per solve
+  buildConstraintIndex(*node, carIndex);
+  TableHeuristic heuristic(getGoalTimes(carIndex, endId));
+  int goalIndex;
+  if (lowLevel == LowLevel::SafeInterval) {
+    SafeIntervals intervals(graph, constraintIndex);
+    SafeIntervalSearch search(graph, searchContext, intervals, heuristic, TableSuccessors(graph),
+                              ReservationConstraint(constraintIndex), PointGoal(endId), IterationBudget());
+    goalIndex = search.run(startId);
+  } else if (suboptimality > 1) {
+    buildPathIndex(*node, carIndex);
+    FocalKinematicSearch search(graph, searchContext, heuristic, TableSuccessors(graph),
+                                ReservationConstraint(constraintIndex), ReservationConflicts(pathIndex),
+                                PointGoal(endId), IterationBudget(), TimedPoseStateKey());
+    goalIndex = search.run(startId, suboptimality);
+  } else {
+    KinematicSearch search(graph, searchContext, heuristic, TableSuccessors(graph),
+                           ReservationConstraint(constraintIndex), PointGoal(endId), IterationBudget(),
+                           TimedPoseStateKey());
+    goalIndex = search.run(startId);
+  }
+  searchStats += searchContext.stats;
+  spdlog::debug("Search stats for car {}: {}", carIndex, searchContext.stats.toJson());
+  if (goalIndex < 0) {
+    spdlog::warn("A* failed to find a path for car {}", carIndex);
+    return false;
   }
 
-  spdlog::warn("A* failed to find a path for car {}", carIndex);
+  double oldCost = node->costs[carIndex];
+  cars[carIndex].assignPath(searchContext.path, graph);
+
+  // Copy on write: the other nodes keep sharing the previous path
+  node->paths[carIndex] = std::make_shared<const std::vector<sf::Vector2f>>(cars[carIndex].getPath());
+  node->costs[carIndex] = searchContext.pathCost;
+  node->cost += node->costs[carIndex] - oldCost;
+
+  // The child has more constraints than its parent, so its optimal cost is at least the bound of the parent
+  double oldLowerBound = node->lowerBounds[carIndex];
+  if (suboptimality > 1)
+    node->lowerBounds[carIndex] =
+        std::max(oldLowerBound, searchContext.pathCost / std::max(searchContext.suboptimalityBound, 1.0));
+  else
+    node->lowerBounds[carIndex] = node->costs[carIndex];
+  node->lowerBound += node->lowerBounds[carIndex] - oldLowerBound;
+  conflictDetector.updateConflicts(node->paths, carIndex, &node->conflictPairs);
+
+  spdlog::debug("Found path for car {} with cost: {}", carIndex, node->costs[carIndex]);
+  return true;
 }
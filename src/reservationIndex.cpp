@@ -0,0 +1,77 @@
+/**
+ * @file reservationIndex.cpp
+ * @brief Spatio-temporal index of the constraints of a car
+ *
+ * This file contains the implementation of the ReservationIndex class.
+ */
+#include "reservationIndex.h"
+#include <algorithm>
+#include <cmath>
+
+void ReservationIndex::clear() {
+  entries.clear();
+  bucketOffsets.clear();
+}
+
+void ReservationIndex::release() {
+  std::vector<entry>().swap(entries);
+  std::vector<int>().swap(bucketOffsets);
+}
+
+void ReservationIndex::add(double time, const sf::Vector2f &position) {
+  entry e;
+  e.bucket = getBucket(time);
+  getCell(position, &e.x, &e.y);
+  e.position = position;
+  entries.push_back(e);
+}
+
+void ReservationIndex::build() {
+  bucketOffsets.clear();
+  if (entries.empty())
+    return;
+
+  std::sort(entries.begin(), entries.end());
+  firstBucket = entries.front().bucket;
+  bucketOffsets.assign(entries.back().bucket - firstBucket + 2, 0);
+  for (const entry &e : entries)
+    bucketOffsets[e.bucket - firstBucket + 1]++;
+  for (std::size_t b = 1; b < bucketOffsets.size(); b++)
+    bucketOffsets[b] += bucketOffsets[b - 1];
+}
+
+bool ReservationIndex::overlaps(double startTime, double endTime) const {
+  return getBucketEnd(getBucket(endTime)) > getBucketBegin(getBucket(startTime));
+}
+
+bool ReservationIndex::isBlocked(int bucket, const sf::Vector2f &position) const {
+  auto begin = entries.begin() + getBucketBegin(bucket);
+  auto end = entries.begin() + getBucketEnd(bucket);
+  float range2 = range * range;
+  auto blocks = [&](const entry &e) {
+    sf::Vector2f diff = position - e.position;
+    return diff.x * diff.x + diff.y * diff.y < range2;
+  };
+
+  if (end - begin <= RESERVATION_SCAN_ENTRIES)
+    return std::any_of(begin, end, blocks);
+
+  // The 3 cells of a column are contiguous in the sort order: one range per column
+  int x, y;
+  getCell(position, &x, &y);
+  for (int dx = -1; dx <= 1; dx++) {
+    entry low{bucket, x + dx, y - 1, {}};
+    entry high{bucket, x + dx, y + 1, {}};
+    auto first = std::lower_bound(begin, end, low);
+    auto last = std::upper_bound(first, end, high);
+    if (std::any_of(first, last, blocks))
+      return true;
+  }
+
+  return false;
+}
+
+void ReservationIndex::getCell(const sf::Vector2f &position, int *x, int *y) const {
+  *x = (int)std::floor(position.x / range);
+  *y = (int)std::floor(position.y / range);
+}
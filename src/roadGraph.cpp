@@ -0,0 +1,123 @@
+/**
+ * @file roadGraph.cpp
+ * @brief Road-level abstraction of the city graph
+ *
+ * This file contains the implementation of the RoadGraph class.
+ */
+#include "roadGraph.h"
+#include "indexedHeap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+static double distance(const sf::Vector2f &a, const sf::Vector2f &b) {
+  sf::Vector2f diff = a - b;
+  return std::sqrt(diff.x * diff.x + diff.y * diff.y);
+}
+
+void RoadGraph::build(const CityMap &cityMap) {
+  auto roads = cityMap.getRoads();
+  auto intersections = cityMap.getIntersections();
+
+  nodes.clear();
+  nodeOffsets.clear();
+  nodeOffsets.reserve(roads.size() + 1);
+  for (int r = 0; r < (int)roads.size(); r++) {
+    nodeOffsets.push_back(nodes.size());
+    for (int s = 0; s < (int)roads[r].segments.size(); s++)
+      nodes.push_back({r, s, (roads[r].segments[s].p1 + roads[r].segments[s].p2) / 2.f});
+  }
+  nodeOffsets.push_back(nodes.size());
+
+  // Consecutive segments of a road, and every pair of segments meeting at an intersection
+  std::vector<std::pair<int, int>> links;
+  for (int r = 0; r < (int)roads.size(); r++) {
+    for (int id = nodeOffsets[r]; id + 1 < nodeOffsets[r + 1]; id++)
+      links.push_back({id, id + 1});
+  }
+  for (const auto &intersection : intersections) {
+    for (const auto &[road1, segment1] : intersection.roadSegmentIds) {
+      for (const auto &[road2, segment2] : intersection.roadSegmentIds) {
+        int id1 = getNodeId(road1, segment1);
+        int id2 = getNodeId(road2, segment2);
+        if (id1 >= 0 && id2 >= 0 && id1 < id2)
+          links.push_back({id1, id2});
+      }
+    }
+  }
+  std::sort(links.begin(), links.end());
+  links.erase(std::unique(links.begin(), links.end()), links.end());
+
+  edgeOffsets.assign(nodes.size() + 1, 0);
+  for (const auto &[a, b] : links) {
+    edgeOffsets[a + 1]++;
+    edgeOffsets[b + 1]++;
+  }
+  for (int id = 0; id < (int)nodes.size(); id++)
+    edgeOffsets[id + 1] += edgeOffsets[id];
+
+  edges.assign(edgeOffsets.back(), {});
+  std::vector<int> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+  for (const auto &[a, b] : links) {
+    double d = distance(nodes[a].center, nodes[b].center);
+    edges[fill[a]++] = {b, d};
+    edges[fill[b]++] = {a, d};
+  }
+
+  spdlog::info("Road graph built with {} segments and {} links", nodes.size(), links.size());
+}
+
+bool RoadGraph::findCorridor(int startId, int endId, int width, std::vector<char> *inCorridor) const {
+  inCorridor->assign(nodes.size(), 0);
+  if (startId < 0 || endId < 0 || startId >= (int)nodes.size() || endId >= (int)nodes.size())
+    return false;
+
+  std::vector<double> g(nodes.size(), std::numeric_limits<double>::infinity());
+  std::vector<int> parent(nodes.size(), -1);
+  IndexedHeap<> openSet;
+  openSet.reserve(nodes.size());
+  g[startId] = 0;
+  openSet.push(startId, distance(nodes[startId].center, nodes[endId].center));
+
+  while (!openSet.empty()) {
+    int current = openSet.pop();
+    if (current == endId)
+      break;
+
+    for (int e = edgeOffsets[current]; e < edgeOffsets[current + 1]; e++) {
+      const edge &link = edges[e];
+      double tentativeG = g[current] + link.distance;
+      if (tentativeG >= g[link.to])
+        continue;
+      g[link.to] = tentativeG;
+      parent[link.to] = current;
+      openSet.push(link.to, tentativeG + distance(nodes[link.to].center, nodes[endId].center));
+    }
+  }
+
+  if (!std::isfinite(g[endId]))
+    return false;
+
+  // The route, then breadth-first rings of neighbors around it
+  std::vector<int> frontier;
+  for (int id = endId; id >= 0; id = parent[id]) {
+    (*inCorridor)[id] = 1;
+    frontier.push_back(id);
+  }
+  for (int ring = 0; ring < width; ring++) {
+    std::vector<int> next;
+    for (int id : frontier) {
+      for (int e = edgeOffsets[id]; e < edgeOffsets[id + 1]; e++) {
+        if ((*inCorridor)[edges[e].to])
+          continue;
+        (*inCorridor)[edges[e].to] = 1;
+        next.push_back(edges[e].to);
+      }
+    }
+    frontier.swap(next);
+  }
+
+  return true;
+}
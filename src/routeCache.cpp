@@ -0,0 +1,84 @@
+/**
+ * @file routeCache.cpp
+ * @brief Cache of unconstrained single-agent routes
+ *
+ * This file contains the implementation of the RouteCache class.
+ */
+#include "routeCache.h"
+#include <spdlog/spdlog.h>
+
+bool RouteCache::find(const CityGraph &graph, const CityGraph::point &start, const CityGraph::point &end,
+                      std::vector<_aStarNode> *path, double *cost) {
+  std::lock_guard<std::mutex> lock(mutex);
+  checkVersion(graph);
+
+  auto it = index.find({start, end, graph.getVersion()});
+  if (it == index.end()) {
+    numMisses++;
+    return false;
+  }
+
+  entries.splice(entries.begin(), entries, it->second);
+  *path = it->second->path;
+  *cost = it->second->cost;
+  numHits++;
+  return true;
+}
+
+void RouteCache::insert(const CityGraph &graph, const CityGraph::point &start, const CityGraph::point &end,
+                        const std::vector<_aStarNode> &path, double cost) {
+  if (capacity == 0)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  checkVersion(graph);
+
+  key k{start, end, graph.getVersion()};
+  auto it = index.find(k);
+  if (it != index.end()) {
+    entries.splice(entries.begin(), entries, it->second);
+    it->second->path = path;
+    it->second->cost = cost;
+    return;
+  }
+
+  if (entries.size() >= capacity) {
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+  entries.push_front({k, path, cost});
+  index[k] = entries.begin();
+}
+
+void RouteCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  index.clear();
+}
+
+std::size_t RouteCache::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+long long RouteCache::getNumHits() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return numHits;
+}
+
+long long RouteCache::getNumMisses() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return numMisses;
+}
+
+void RouteCache::checkVersion(const CityGraph &graph) {
+  if (graph.getVersion() == version)
+    return;
+
+  if (!entries.empty())
+    spdlog::debug("Graph changed (version {} to {}), {} cached routes dropped", version, graph.getVersion(),
+                  entries.size());
+  entries.clear();
+  index.clear();
+  version = graph.getVersion();
+}
@@ -0,0 +1,97 @@
+/**
+ * @file routePlanner.cpp
+ * @brief Batch route planning
+ *
+ * This file contains the implementation of the RoutePlanner class.
+ */
+#include "routePlanner.h"
+#include <cmath>
+#include <unordered_map>
+
+RoutePlanner::RoutePlanner(const CityGraph &cityGraph, int numThreads) : graph(cityGraph), pool(numThreads) {
+  searches.reserve(pool.getNumThreads());
+  for (int i = 0; i < pool.getNumThreads(); i++) {
+    searches.push_back(std::make_unique<AStar>(graph));
+    searches.back()->setCache(&cache);
+  }
+}
+
+std::vector<RoutePlanner::route> RoutePlanner::planRoutes(const std::vector<query> &queries) {
+  // Queries sharing a start point (a depot) are answered by one one-to-many search
+  std::unordered_map<CityGraph::point, int> groupOfStart;
+  std::vector<std::vector<int>> groups;
+  for (int i = 0; i < (int)queries.size(); i++) {
+    auto [it, inserted] = groupOfStart.emplace(queries[i].first, groups.size());
+    if (inserted)
+      groups.emplace_back();
+    groups[it->second].push_back(i);
+  }
+
+  std::vector<route> routes(queries.size());
+  pool.parallelFor(groups.size(), [&](int groupIndex, int threadIndex) {
+    const std::vector<int> &group = groups[groupIndex];
+    AStar &aStar = *searches[threadIndex];
+    for (int index : group) {
+      routes[index].start = queries[index].first;
+      routes[index].end = queries[index].second;
+    }
+
+    if (group.size() == 1) {
+      routes[group[0]].path = aStar.findPath(queries[group[0]].first, queries[group[0]].second);
+      return;
+    }
+
+    std::vector<CityGraph::point> ends;
+    ends.reserve(group.size());
+    for (int index : group)
+      ends.push_back(queries[index].second);
+    std::vector<std::vector<AStar::node>> paths = aStar.findPaths(queries[group[0]].first, ends);
+    for (int i = 0; i < (int)group.size(); i++)
+      routes[group[i]].path = std::move(paths[i]);
+  });
+
+  return routes;
+}
+
+std::vector<RoutePlanner::route> RoutePlanner::planRandomRoutes(int numRoutes, unsigned int seed) {
+  std::vector<route> routes(numRoutes);
+  pool.parallelFor(numRoutes, [&](int index, int threadIndex) {
+    std::seed_seq seq{seed, (unsigned int)index};
+    std::mt19937 gen(seq);
+    routes[index] = planRandomRoute(graph, *searches[threadIndex], gen);
+  });
+
+  return routes;
+}
+
+RoutePlanner::route RoutePlanner::planRandomRoute(const CityGraph &graph, AStar &aStar, std::mt19937 &gen) {
+  route r;
+  double minDistance = std::max(graph.getWidth(), graph.getHeight()) / 2.0;
+
+  do {
+    r.start = graph.getRandomPoint(gen);
+    r.end = graph.getRandomPoint(gen);
+
+    if (std::sqrt(std::pow(r.start.position.x - r.end.position.x, 2) +
+                  std::pow(r.start.position.y - r.end.position.y, 2)) < minDistance) {
+      r.path.clear();
+      continue;
+    }
+
+    r.path = aStar.findPath(r.start, r.end);
+  } while ((int)r.path.size() < 3);
+
+  return r;
+}
+
+AStar::stats RoutePlanner::getStats() const {
+  AStar::stats total;
+  for (const auto &search : searches)
+    total += search->getTotalStats();
+  return total;
+}
+
+void RoutePlanner::resetStats() {
+  for (auto &search : searches)
+    search->resetStats();
+}
@@ -0,0 +1,16 @@
+/**
+ * @file searchStats.cpp
+ * @brief Statistics of the path searches
+ *
+ * This file contains the implementation of the SearchStats struct.
+ */
+#include "searchStats.h"
+#include <spdlog/fmt/fmt.h>
+
+std::string _searchStats::toJson() const {
+  return fmt::format("{{\"searches\": {}, \"found\": {}, \"expansions\": {}, \"generated\": {}, \"pruned\": {}, "
+                     "\"reopened\": {}, \"duplicates\": {}, \"peakOpenSet\": {}, \"probes\": {}, "
+                     "\"successorTime\": {:.6f}, \"constraintTime\": {:.6f}, \"wallTime\": {:.6f}}}",
+                     numSearches, numFound, numExpansions, numGenerated, numPruned, numReopened, numDuplicates,
+                     peakOpenSet, numProbes, successorTime, constraintTime, wallTime);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file threadPool.cpp
+ * @brief Fixed pool of worker threads
+ *
+ * This file contains the implementation of the ThreadPool class.
+ */
+#include "threadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) {
+  if (numThreads <= 0)
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  workers.reserve(numThreads);
+  for (int i = 0; i < numThreads; i++)
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void ThreadPool::parallelFor(int numTasks, const std::function<void(int, int)> &task) {
+  if (numTasks <= 0)
+    return;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  this->task = &task;
+  this->numTasks = numTasks;
+  nextTask = 0;
+  numBusy = (int)workers.size();
+  error = nullptr;
+  generation++;
+  wakeUp.notify_all();
+
+  done.wait(lock, [this] { return numBusy == 0; });
+  this->task = nullptr;
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop(int threadIndex) {
+  unsigned int seenGeneration = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+    if (stopping)
+      return;
+    seenGeneration = generation;
+
+    // Tasks are handed out one at a time, so long queries do not leave the other threads idle
+    while (nextTask < numTasks) {
+      int taskIndex = nextTask++;
+      lock.unlock();
+      try {
+        (*task)(taskIndex, threadIndex);
+      } catch (...) {
+        lock.lock();
+        if (!error)
+          error = std::current_exception();
+        continue;
+      }
+      lock.lock();
+    }
+
+    if (--numBusy == 0)
+      done.notify_one();
+  }
+}
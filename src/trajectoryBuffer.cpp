@@ -0,0 +1,141 @@
+/**
+ * @file trajectoryBuffer.cpp
+ * @brief Time-major structure-of-arrays storage of the sampled paths of the cars
+ *
+ * This file contains the implementation of the TrajectoryBuffer class and the distance kernels, with their runtime
+ * dispatch.
+ */
+#include "trajectoryBuffer.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRAJECTORY_KERNEL_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TRAJECTORY_KERNEL_NEON 1
+#endif
+
+// Positions of the arrived cars and of the padding: far from the map and TRAJECTORY_PARKING_SPACING apart from each
+// other, small enough for their squared distances to stay finite in float
+static constexpr float TRAJECTORY_PARKING_X = 1e7f;
+static constexpr float TRAJECTORY_PARKING_SPACING = 100.f;
+
+void TrajectoryBuffer::assign(const paths &paths, int firstStep, int maxSteps) {
+  numCars = paths.size();
+  numSteps = 0;
+  lengths.resize(numCars);
+  for (int car = 0; car < numCars; car++) {
+    lengths[car] = paths[car]->size();
+    numSteps = std::max(numSteps, lengths[car]);
+  }
+  stride = (numCars + TRAJECTORY_LANES - 1) / TRAJECTORY_LANES * TRAJECTORY_LANES;
+  this->firstStep = std::min(firstStep, numSteps);
+  endStep = this->firstStep + std::min(maxSteps, numSteps - this->firstStep);
+
+  std::size_t numRows = endStep - this->firstStep;
+  x.resize(numRows * stride);
+  y.resize(numRows * stride);
+  for (int car = 0; car < stride; car++) {
+    float parkingX = TRAJECTORY_PARKING_X + car * TRAJECTORY_PARKING_SPACING;
+    int length = car < numCars ? std::min(lengths[car], endStep) : 0;
+    std::size_t row = 0;
+    for (int t = this->firstStep; t < length; t++, row++) {
+      x[row * stride + car] = (*paths[car])[t].x;
+      y[row * stride + car] = (*paths[car])[t].y;
+    }
+    for (; row < numRows; row++) {
+      x[row * stride + car] = parkingX;
+      y[row * stride + car] = 0;
+    }
+  }
+}
+
+static int findFirstInRangeScalar(const float *x, const float *y, int count, float px, float py, float range2) {
+  for (int i = 0; i < count; i++) {
+    float dx = x[i] - px;
+    float dy = y[i] - py;
+    if (dx * dx + dy * dy < range2)
+      return i;
+  }
+  return -1;
+}
+
+#ifdef TRAJECTORY_KERNEL_AVX2
+__attribute__((target("avx2"))) static int findFirstInRangeAvx2(const float *x, const float *y, int count, float px,
+                                                                float py, float range2) {
+  const __m256 vpx = _mm256_set1_ps(px);
+  const __m256 vpy = _mm256_set1_ps(py);
+  const __m256 vrange2 = _mm256_set1_ps(range2);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), vpx);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), vpy);
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, vrange2, _CMP_LT_OQ));
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+  int tail = findFirstInRangeScalar(x + i, y + i, count - i, px, py, range2);
+  return tail < 0 ? -1 : i + tail;
+}
+#endif
+
+#ifdef TRAJECTORY_KERNEL_NEON
+static int findFirstInRangeNeon(const float *x, const float *y, int count, float px, float py, float range2) {
+  const float32x4_t vpx = vdupq_n_f32(px);
+  const float32x4_t vpy = vdupq_n_f32(py);
+  const float32x4_t vrange2 = vdupq_n_f32(range2);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t dx = vsubq_f32(vld1q_f32(x + i), vpx);
+    float32x4_t dy = vsubq_f32(vld1q_f32(y + i), vpy);
+    float32x4_t d2 = vmlaq_f32(vmulq_f32(dx, dx), dy, dy);
+    uint32x4_t lower = vcltq_f32(d2, vrange2);
+    if (vmaxvq_u32(lower) != 0) {
+      uint32_t lanes[4];
+      vst1q_u32(lanes, lower);
+      for (int k = 0; k < 4; k++) {
+        if (lanes[k] != 0)
+          return i + k;
+      }
+    }
+  }
+  int tail = findFirstInRangeScalar(x + i, y + i, count - i, px, py, range2);
+  return tail < 0 ? -1 : i + tail;
+}
+#endif
+
+using TrajectoryKernel = int (*)(const float *, const float *, int, float, float, float);
+
+static TrajectoryKernel selectKernel(const char **name) {
+#ifdef TRAJECTORY_KERNEL_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    *name = "avx2";
+    return findFirstInRangeAvx2;
+  }
+#endif
+#ifdef TRAJECTORY_KERNEL_NEON
+  *name = "neon";
+  return findFirstInRangeNeon;
+#endif
+  *name = "scalar";
+  return findFirstInRangeScalar;
+}
+
+static const char *kernelName = nullptr;
+
+// Selected at the first call rather than during static initialization, so it is ready whatever the initialization order
+static TrajectoryKernel getKernel() {
+  static const TrajectoryKernel kernel = selectKernel(&kernelName);
+  return kernel;
+}
+
+int findFirstInRange(const float *x, const float *y, int count, float px, float py, float range2) {
+  return getKernel()(x, y, count, px, py, range2);
+}
+
+const char *getTrajectoryKernelName() {
+  getKernel();
+  return kernelName;
+}
@@ -19,18 +19,19 @@ sf::Font loadFont() {
   return font;
 }
 
-bool carsCollided(const Car car1, const Car car2, const int time) {
-  const std::vector<sf::Vector2f> path1 = car1.getPath();
-  const std::vector<sf::Vector2f> path2 = car2.getPath();
-  
+bool carsCollided(const Car &car1, const Car &car2, const int time) {
+  const std::vector<sf::Vector2f> &path1 = car1.getPath();
+  const std::vector<sf::Vector2f> &path2 = car2.getPath();
+
   // Validate time index is within bounds
   if (time < 0 || time >= static_cast<int>(path1.size()) || time >= static_cast<int>(path2.size())) {
     return false;
   }
-  
+
+  // Squared in float, like the conflict check of the planner
   const sf::Vector2f diff = path1[time] - path2[time];
-  const double dist = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-  return dist < CAR_LENGTH * COLLISION_SAFETY_FACTOR;
+  const float range = CAR_LENGTH * COLLISION_SAFETY_FACTOR;
+  return diff.x * diff.x + diff.y * diff.y < range * range;
 }
 
 bool carConflict(const sf::Vector2f carPos, const sf::Angle carAngle, 